@@ -1,12 +1,22 @@
 #version 450
+#extension GL_ARB_shader_draw_parameters : require
 
 #include "utils.glsl"
 
+#ifdef COMPACT_VERTICES
+// See CompactVertex
+layout(location = 0) in vec4 in_pos_bitangent_sign;
+layout(location = 1) in vec2 in_normal;
+layout(location = 2) in vec2 in_uv;
+layout(location = 3) in vec2 in_tangent;
+layout(location = 4) in vec4 in_color;
+#else
 layout(location = 0) in vec3 in_pos;
 layout(location = 1) in vec3 in_normal;
 layout(location = 2) in vec2 in_uv;
 layout(location = 3) in vec4 in_tangent_bitangent_sign;
 layout(location = 4) in vec3 in_color;
+#endif
 
 layout(location = 0) out vec3 out_normal;
 layout(location = 1) out vec2 out_uv;
@@ -14,23 +24,60 @@ layout(location = 2) out vec3 out_color;
 layout(location = 3) out vec3 out_position;
 layout(location = 4) out vec3 out_tangent;
 layout(location = 5) out vec3 out_bitangent;
+#ifdef BINDLESS_TEXTURES
+layout(location = 6) flat out uint out_material;
+#endif
 
 layout(binding = 0) uniform Data {
     FrameData frame;
 };
 
-uniform mat4 model;
+layout(std430, binding = 2) readonly buffer Transforms {
+    mat4 transforms[];
+};
+
+layout(std430, binding = 3) readonly buffer Instances {
+    uint instances[];
+};
+
+layout(std430, binding = 4) readonly buffer Draws {
+    DrawData draws[];
+};
+
+// Index in draws of the first draw of the current (multi) draw call
+uniform uint draw_offset;
+
+// Must match depth.vert exactly for the depth pre-pass
+invariant gl_Position;
 
 void main() {
+    const DrawData draw = draws[draw_offset + gl_DrawIDARB];
+    const mat4 model = transforms[instances[draw.first_instance + gl_InstanceID]];
+
+#ifdef COMPACT_VERTICES
+    const vec4 position = model * vec4(dequantize_position(in_pos_bitangent_sign.xyz, draw), 1.0);
+    const vec3 normal = octahedral_decode_snorm(in_normal);
+    const vec3 tangent = octahedral_decode_snorm(in_tangent);
+    const float bitangent_sign = in_pos_bitangent_sign.w > 0.5 ? 1.0 : -1.0;
+    const vec3 color = in_color.rgb;
+#else
     const vec4 position = model * vec4(in_pos, 1.0);
+    const vec3 normal = in_normal;
+    const vec3 tangent = in_tangent_bitangent_sign.xyz;
+    const float bitangent_sign = in_tangent_bitangent_sign.w > 0.0 ? 1.0 : -1.0;
+    const vec3 color = in_color;
+#endif
 
-    out_normal = normalize(mat3(model) * in_normal);
-    out_tangent = normalize(mat3(model) * in_tangent_bitangent_sign.xyz);
-    out_bitangent = cross(out_tangent, out_normal) * (in_tangent_bitangent_sign.w > 0.0 ? 1.0 : -1.0);
+    out_normal = normalize(mat3(model) * normal);
+    out_tangent = normalize(mat3(model) * tangent);
+    out_bitangent = cross(out_tangent, out_normal) * bitangent_sign;
 
     out_uv = in_uv;
-    out_color = in_color;
+    out_color = color;
     out_position = position.xyz;
+#ifdef BINDLESS_TEXTURES
+    out_material = draw.material_index;
+#endif
 
     gl_Position = frame.camera.view_proj * position;
 }
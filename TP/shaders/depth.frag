@@ -0,0 +1,6 @@
+#version 450
+
+// Depth only pass, nothing to shade
+
+void main() {
+}
@@ -0,0 +1,46 @@
+#version 450
+#extension GL_ARB_shader_draw_parameters : require
+
+#include "utils.glsl"
+
+// Position only version of basic.vert, for the depth pre-pass.
+// Positions must be computed exactly as in basic.vert for the G-buffer pass to pass the EQUAL depth test.
+
+#ifdef COMPACT_VERTICES
+layout(location = 0) in vec4 in_pos;
+#else
+layout(location = 0) in vec3 in_pos;
+#endif
+
+layout(binding = 0) uniform Data {
+    FrameData frame;
+};
+
+layout(std430, binding = 2) readonly buffer Transforms {
+    mat4 transforms[];
+};
+
+layout(std430, binding = 3) readonly buffer Instances {
+    uint instances[];
+};
+
+layout(std430, binding = 4) readonly buffer Draws {
+    DrawData draws[];
+};
+
+// Index in draws of the first draw of the current (multi) draw call
+uniform uint draw_offset;
+
+invariant gl_Position;
+
+void main() {
+    const DrawData draw = draws[draw_offset + gl_DrawIDARB];
+    const mat4 model = transforms[instances[draw.first_instance + gl_InstanceID]];
+#ifdef COMPACT_VERTICES
+    const vec4 position = model * vec4(dequantize_position(in_pos.xyz, draw), 1.0);
+#else
+    const vec4 position = model * vec4(in_pos, 1.0);
+#endif
+
+    gl_Position = frame.camera.view_proj * position;
+}
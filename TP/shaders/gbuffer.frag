@@ -1,4 +1,7 @@
 #version 450
+#ifdef BINDLESS_TEXTURES
+#extension GL_ARB_bindless_texture : require
+#endif
 
 #include "utils.glsl"
 
@@ -8,27 +11,48 @@ layout(location = 2) in vec3 in_color;
 layout(location = 3) in vec3 in_position;
 layout(location = 4) in vec3 in_tangent;
 layout(location = 5) in vec3 in_bitangent;
+#ifdef BINDLESS_TEXTURES
+layout(location = 6) flat in uint in_material;
+#endif
 
 layout(location = 0) out vec4 g_color;
-layout(location = 1) out vec4 g_normal;
+layout(location = 1) out vec2 g_normal;
 
+#ifdef BINDLESS_TEXTURES
+// Indexed by the draw's material, so handles are the same for every fragment of a draw
+layout(std430, binding = 15) readonly buffer Materials {
+    MaterialData materials[];
+};
+#else
 layout(binding = 0) uniform sampler2D u_texture;
 layout(binding = 1) uniform sampler2D u_normalMap;
+#endif
 
 void main() {
-#ifdef NORMAL_MAPPED
+#ifdef BINDLESS_TEXTURES
+    const MaterialData material = materials[in_material];
+    vec3 normal = in_normal;
+    if(material.normal != uvec2(0)) {
+        const vec3 normalMap = unpack_normal_map(texture(sampler2D(material.normal), in_uv).rg);
+        normal = normalMap.x * in_tangent + normalMap.y * in_bitangent + normalMap.z * in_normal;
+    }
+#elif defined(NORMAL_MAPPED)
     const vec3 normalMap = unpack_normal_map(texture(u_normalMap, in_uv).rg);
     const vec3 normal = normalMap.x * in_tangent + normalMap.y * in_bitangent + normalMap.z * in_normal;
 #else
     const vec3 normal = in_normal;
 #endif
 
-    // Store normal in gbuffer (rgba format)
-    g_normal = vec4((normalize(normal) + 1.0) / 2.0, 1.0);
-    // Store color in gbuffer (rgba format)
+    // Store normal in gbuffer (octahedral encoding)
+    g_normal = octahedral_encode(normalize(normal));
+    // Store color in gbuffer (sRGB, alpha is unused)
     g_color = vec4(in_color, 1.0);
 
-#ifdef TEXTURED
+#ifdef BINDLESS_TEXTURES
+    if(material.albedo != uvec2(0)) {
+        g_color *= texture(sampler2D(material.albedo), in_uv);
+    }
+#elif defined(TEXTURED)
     g_color *= texture(u_texture, in_uv);
 #endif
 }
\ No newline at end of file
@@ -0,0 +1,45 @@
+#version 450
+
+#include "utils.glsl"
+
+// fragment shader of the light volumes: shades the G-buffer pixel with a single light
+
+layout(location = 0) out vec4 out_color;
+
+layout(location = 0) flat in uint in_light;
+
+layout(binding = 0) uniform sampler2D in_color_texture;
+layout(binding = 1) uniform sampler2D in_normal_texture;
+layout(binding = 2) uniform sampler2D in_depth_texture;
+
+layout(binding = 0) uniform Data {
+    FrameData frame;
+};
+
+layout(std430, binding = 1) readonly buffer PointLights {
+    PointLight point_lights[];
+};
+
+void main() {
+    const ivec2 coord = ivec2(gl_FragCoord.xy);
+    const float in_depth = texelFetch(in_depth_texture, coord, 0).r;
+    const vec2 uv = gl_FragCoord.xy / vec2(textureSize(in_depth_texture, 0));
+    const vec3 in_position = unproject(uv, in_depth, inverse(frame.camera.view_proj));
+
+    const PointLight light = point_lights[in_light];
+    const vec3 to_light = light.position - in_position;
+    const float dist = length(to_light);
+    if(dist >= light.radius) {
+        discard;
+    }
+
+    const vec3 in_normal = octahedral_decode(texelFetch(in_normal_texture, coord, 0).xy);
+    const float NoL = dot(to_light / dist, in_normal);
+    const float att = attenuation(dist, light.radius);
+    if(NoL <= 0.0 || att <= 0.0) {
+        discard;
+    }
+
+    const vec3 in_color = texelFetch(in_color_texture, coord, 0).rgb;
+    out_color = vec4(in_color * light.color * (NoL * att), 0.0);
+}
@@ -0,0 +1,31 @@
+#version 450
+
+#include "utils.glsl"
+
+// vertex shader of the light volumes: one sphere instance per light
+
+layout(location = 0) in vec3 in_pos;
+
+layout(location = 0) flat out uint out_light;
+
+layout(binding = 0) uniform Data {
+    FrameData frame;
+};
+
+layout(std430, binding = 1) readonly buffer PointLights {
+    PointLight point_lights[];
+};
+
+layout(std430, binding = 2) readonly buffer VolumeLights {
+    uint volume_lights[];
+};
+
+// Index in volume_lights of the first light of the draw
+uniform uint light_offset;
+
+void main() {
+    out_light = volume_lights[light_offset + gl_InstanceID];
+
+    const PointLight light = point_lights[out_light];
+    gl_Position = frame.camera.view_proj * vec4(light.position + in_pos * light.radius, 1.0);
+}
@@ -3,6 +3,7 @@
 #include "utils.glsl"
 
 // fragment shader of the main lighting pass
+// With LIGHT_VOLUMES, point lights are drawn afterward by light_volume.frag and only the sun is computed here
 
 layout(location = 0) out vec4 out_color;
 
@@ -16,24 +17,53 @@ layout(binding = 0) uniform Data {
     FrameData frame;
 };
 
-layout(binding = 1) buffer PointLights {
+layout(std430, binding = 1) buffer PointLights {
     PointLight point_lights[];
 };
 
+// Built by light_cull.comp
+#ifndef LIGHT_VOLUMES
+layout(std430, binding = 2) readonly buffer Clusters {
+    LightCluster clusters[];
+};
+
+layout(std430, binding = 3) readonly buffer LightIndices {
+    uint light_index_count;
+    uint light_indices[];
+};
+#endif
+
 const vec3 ambient = vec3(0.0);
 
 void main() {
     vec3 in_color = texelFetch(in_color_texture, ivec2(gl_FragCoord.xy), 0).rgb;
-    vec3 in_normal = texelFetch(in_normal_texture, ivec2(gl_FragCoord.xy), 0).xyz;
-    in_normal = normalize(in_normal * 2.0 - 1.0);
+    const vec3 in_normal = octahedral_decode(texelFetch(in_normal_texture, ivec2(gl_FragCoord.xy), 0).xy);
     float in_depth = texelFetch(in_depth_texture, ivec2(gl_FragCoord.xy), 0).r;
 
     vec3 in_position = unproject(in_uv, in_depth, inverse(frame.camera.view_proj));
 
     vec3 acc = frame.sun_color * max(0.0, dot(frame.sun_dir, in_normal)) + ambient;
 
-    for(uint i = 0; i != frame.point_light_count; ++i) {
-        PointLight light = point_lights[i];
+#ifndef LIGHT_VOLUMES
+    // Only go through the lights of the pixel's cluster
+    const uint tile_count_x = (uint(textureSize(in_depth_texture, 0).x) + cluster_tile_size - 1) / cluster_tile_size;
+    const uvec2 tile = uvec2(gl_FragCoord.xy) / cluster_tile_size;
+    const uint slice = cluster_slice(linear_depth(in_depth, frame.camera.proj));
+    const LightCluster cluster = clusters[cluster_index(tile, tile_count_x, slice)];
+
+    const vec2 ndc = in_uv * 2.0 - 1.0;
+    const float view_depth = linear_depth(in_depth, frame.camera.proj);
+
+    for(uint i = 0; i != cluster.light_count; ++i) {
+        PointLight light = point_lights[light_indices[cluster.first_light + i]];
+
+        // Cheap rejection using the light's screen rect and depth range
+        const vec2 depth_range = unpackHalf2x16(light.depth_range);
+        const bool outside_rect = any(lessThan(ndc, light.screen_rect.xy)) || any(greaterThan(ndc, light.screen_rect.zw));
+        if(outside_rect || view_depth < depth_range.x || view_depth > depth_range.y) {
+            continue;
+        }
+
         const vec3 to_light = (light.position - in_position);
         const float dist = length(to_light);
         const vec3 light_vec = to_light / dist;
@@ -46,6 +76,7 @@ void main() {
 
         acc += light.color * (NoL * att);
     }
+#endif
 
     out_color = vec4(in_color * acc, 1.0);
 
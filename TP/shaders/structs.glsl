@@ -1,5 +1,24 @@
+// Light clusters split the screen in tiles of cluster_tile_size pixels,
+// and every tile in cluster_slice_count depth slices, exponentially distributed between cluster_near and cluster_far
+const uint cluster_tile_size = 16;
+const uint cluster_slice_count = 32;
+const float cluster_near = 0.1f;
+const float cluster_far = 1000.0f;
+
+// Must match max_mesh_lods in MeshArena.h
+const uint max_mesh_lods = 4;
+
 struct CameraData {
     mat4 view_proj;
+    mat4 view;
+    mat4 proj;
+
+    vec3 position;
+    float padding_1;
+
+    // Near, top, bottom, right and left planes (there is no far plane).
+    // xyz is the normal, pointing inside the frustum, w the offset
+    vec4 frustum_planes[5];
 };
 
 struct FrameData {
@@ -16,6 +35,85 @@ struct PointLight {
     vec3 position;
     float radius;
     vec3 color;
-    float padding_1;
+    // Conservative view depth range of the light, as two halves (packHalf2x16)
+    uint depth_range;
+    // Conservative NDC rect of the light: min xy, max zw
+    vec4 screen_rect;
+};
+
+struct DrawData {
+    // Compact vertex positions decode to position_offset + position * position_scale
+    vec3 position_offset;
+    uint first_instance;
+    vec3 position_scale;
+    uint material_index;
+};
+
+// Bindless texture handles of a material, indexed by DrawData::material_index. 0 when the material has no such texture.
+struct MaterialData {
+    uvec2 albedo;
+    uvec2 normal;
+};
+
+struct ObjectData {
+    // Bounding sphere in mesh space
+    vec3 bounding_center;
+    float bounding_radius;
+
+    uint object_index;
+    // Draws of the LODs of the object follow each other, from draw_index
+    uint draw_index;
+    uint lod_count;
+    // Draw of the culled meshlets of the object (see meshlet_cull.comp), or invalid_draw_index
+    uint meshlet_draw_index;
+
+    // Simplification error of each LOD, relative to the bounding radius
+    vec4 lod_errors;
+};
+
+struct CullingStats {
+    uint drawn_objects;
+    uint culled_objects;
+    uint occluded_objects;
+    uint drawn_triangles;
+
+    uint lod_objects[max_mesh_lods];
+
+    uint drawn_meshlets;
+    uint culled_meshlets;
+    uint padding_1;
+    uint padding_2;
+};
+
+const uint invalid_draw_index = 0xFFFFFFFF;
+
+struct Meshlet {
+    // Bounding sphere in mesh space
+    vec3 center;
+    float radius;
+
+    // All triangle normals are within the cone around cone_axis, of half angle acos(sqrt(1 - cone_cutoff^2)).
+    // The meshlet is back facing when seen from a point p if dot(center - p, cone_axis) >= cone_cutoff * length(center - p) + radius.
+    // A cutoff of 1 never culls.
+    vec3 cone_axis;
+    float cone_cutoff;
+
+    uint first_index;
+    uint triangle_count;
+    uint padding_1;
+    uint padding_2;
 };
 
+// Meshlet of an object, culled by meshlet_cull.comp
+struct MeshletInstance {
+    // Index in the culled objects, not in the scene
+    uint object;
+    uint meshlet;
+    uint padding_1;
+    uint padding_2;
+};
+
+struct LightCluster {
+    uint first_light;
+    uint light_count;
+};
@@ -60,6 +60,53 @@ vec3 unpack_normal_map(vec2 normal) {
     return vec3(normal, 1.0 - sqrt(dot(normal, normal)));
 }
 
+vec2 sign_not_zero(vec2 v) {
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// Octahedral encoding of a unit vector into [0, 1]^2
+vec2 octahedral_encode(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    const vec2 oct = n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * sign_not_zero(n.xy);
+    return oct * 0.5 + 0.5;
+}
+
+// Octahedral decoding from [-1, 1]^2, as stored in compact vertices
+vec3 octahedral_decode_snorm(vec2 oct) {
+    vec3 n = vec3(oct, 1.0 - abs(oct.x) - abs(oct.y));
+    const float t = max(-n.z, 0.0);
+    n.xy -= t * sign_not_zero(n.xy);
+    return normalize(n);
+}
+
+vec3 octahedral_decode(vec2 encoded) {
+    return octahedral_decode_snorm(encoded * 2.0 - 1.0);
+}
+
+// Positions of compact vertices are normalized to the bounding box of their mesh
+vec3 dequantize_position(vec3 position, DrawData draw) {
+    return draw.position_offset + position * draw.position_scale;
+}
+
+// Distance along the view direction, for the infinite reverse-Z projection
+float linear_depth(float depth, mat4 proj) {
+    return proj[3][2] / depth;
+}
+
+uint cluster_slice(float view_depth) {
+    const float slice = log(view_depth / cluster_near) / log(cluster_far / cluster_near) * float(cluster_slice_count);
+    return uint(clamp(slice, 0.0, float(cluster_slice_count - 1)));
+}
+
+// View depth where the slice begins
+float cluster_slice_begin(uint slice) {
+    return cluster_near * pow(cluster_far / cluster_near, float(slice) / float(cluster_slice_count));
+}
+
+uint cluster_index(uvec2 tile, uint tile_count_x, uint slice) {
+    return (tile.y * tile_count_x + tile.x) * cluster_slice_count + slice;
+}
+
 vec3 unproject(vec2 uv, float depth, mat4 inverse_viewproj) {
     vec4 clip = vec4(uv * 2.0 - 1.0, depth, 1.0);
     vec4 world = inverse_viewproj * clip;
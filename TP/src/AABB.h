@@ -0,0 +1,49 @@
+#ifndef AABB_H
+#define AABB_H
+
+#include <glm/vec3.hpp>
+#include <glm/common.hpp>
+
+#include <limits>
+
+namespace OM3D {
+
+struct AABB {
+    glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+
+    bool is_empty() const {
+        return min.x > max.x || min.y > max.y || min.z > max.z;
+    }
+
+    glm::vec3 center() const {
+        return (min + max) * 0.5f;
+    }
+
+    glm::vec3 extent() const {
+        return max - min;
+    }
+
+    // Half of the surface area, enough for SAH cost comparisons
+    float half_area() const {
+        if(is_empty()) {
+            return 0.0f;
+        }
+        const glm::vec3 e = extent();
+        return e.x * e.y + e.y * e.z + e.z * e.x;
+    }
+
+    void extend(const glm::vec3& point) {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    void extend(const AABB& other) {
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+    }
+};
+
+}
+
+#endif // AABB_H
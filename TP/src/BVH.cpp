@@ -0,0 +1,252 @@
+#include "BVH.h"
+
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <numeric>
+
+namespace OM3D {
+
+static constexpr u32 bin_count = 16;
+static constexpr u32 max_leaf_size = 4;
+
+static float intersect_box(const Ray& ray, const glm::vec3& inv_dir, const glm::vec3& box_min, const glm::vec3& box_max) {
+    const glm::vec3 t0 = (box_min - ray.origin) * inv_dir;
+    const glm::vec3 t1 = (box_max - ray.origin) * inv_dir;
+    const glm::vec3 t_min = glm::min(t0, t1);
+    const glm::vec3 t_max = glm::max(t0, t1);
+
+    const float enter = std::max(std::max(t_min.x, t_min.y), std::max(t_min.z, 0.0f));
+    const float exit = std::min(std::min(t_max.x, t_max.y), t_max.z);
+    return enter <= exit ? enter : std::numeric_limits<float>::infinity();
+}
+
+BVH::BVH(Span<const AABB> bounds) : _item_bounds(bounds.begin(), bounds.end()) {
+    if(bounds.is_empty()) {
+        return;
+    }
+
+    _items.resize(bounds.size());
+    std::iota(_items.begin(), _items.end(), 0u);
+
+    std::vector<glm::vec3> centroids(bounds.size());
+    for(size_t i = 0; i != bounds.size(); ++i) {
+        centroids[i] = bounds[i].center();
+    }
+
+    _nodes.reserve(2 * bounds.size());
+    build_node(0, u32(_items.size()), centroids);
+
+    // Store item bounds in traversal order
+    std::vector<AABB> ordered_bounds(_items.size());
+    for(size_t i = 0; i != _items.size(); ++i) {
+        ordered_bounds[i] = _item_bounds[_items[i]];
+    }
+    _item_bounds = std::move(ordered_bounds);
+}
+
+bool BVH::is_empty() const {
+    return _nodes.empty();
+}
+
+size_t BVH::item_count() const {
+    return _items.size();
+}
+
+size_t BVH::node_count() const {
+    return _nodes.size();
+}
+
+u32 BVH::item_end(u32 node_index) const {
+    const u32 skip = _nodes[node_index].skip;
+    return skip < _nodes.size() ? _nodes[skip].first_item : u32(_items.size());
+}
+
+void BVH::build_node(u32 begin, u32 end, std::vector<glm::vec3>& centroids) {
+    const u32 node_index = u32(_nodes.size());
+    _nodes.emplace_back();
+
+    AABB node_bounds;
+    AABB centroid_bounds;
+    for(u32 i = begin; i != end; ++i) {
+        node_bounds.extend(_item_bounds[_items[i]]);
+        centroid_bounds.extend(centroids[_items[i]]);
+    }
+
+    const u32 count = end - begin;
+    u32 split = begin;
+
+    if(count > max_leaf_size) {
+        const glm::vec3 centroid_extent = centroid_bounds.extent();
+
+        float best_cost = std::numeric_limits<float>::max();
+        int best_axis = -1;
+        u32 best_bin = 0;
+
+        auto bin_index = [&](u32 item, int axis) {
+            const float scale = float(bin_count) / centroid_extent[axis];
+            return std::min(bin_count - 1, u32((centroids[item][axis] - centroid_bounds.min[axis]) * scale));
+        };
+
+        for(int axis = 0; axis != 3; ++axis) {
+            if(centroid_extent[axis] <= 0.0f) {
+                continue;
+            }
+
+            AABB bin_bounds[bin_count];
+            u32 bin_counts[bin_count] = {};
+            for(u32 i = begin; i != end; ++i) {
+                const u32 bin = bin_index(_items[i], axis);
+                bin_bounds[bin].extend(_item_bounds[_items[i]]);
+                ++bin_counts[bin];
+            }
+
+            // Sweep right to left then left to right to evaluate every split plane between bins
+            float right_areas[bin_count] = {};
+            u32 right_counts[bin_count] = {};
+            {
+                AABB acc;
+                u32 acc_count = 0;
+                for(u32 bin = bin_count - 1; bin > 0; --bin) {
+                    acc.extend(bin_bounds[bin]);
+                    acc_count += bin_counts[bin];
+                    right_areas[bin] = acc.half_area();
+                    right_counts[bin] = acc_count;
+                }
+            }
+            {
+                AABB acc;
+                u32 acc_count = 0;
+                for(u32 bin = 0; bin != bin_count - 1; ++bin) {
+                    acc.extend(bin_bounds[bin]);
+                    acc_count += bin_counts[bin];
+
+                    if(!acc_count || !right_counts[bin + 1]) {
+                        continue;
+                    }
+
+                    const float cost = acc.half_area() * float(acc_count) + right_areas[bin + 1] * float(right_counts[bin + 1]);
+                    if(cost < best_cost) {
+                        best_cost = cost;
+                        best_axis = axis;
+                        best_bin = bin;
+                    }
+                }
+            }
+        }
+
+        if(best_axis >= 0) {
+            const auto it = std::partition(_items.begin() + begin, _items.begin() + end, [&](u32 item) {
+                return bin_index(item, best_axis) <= best_bin;
+            });
+            split = u32(it - _items.begin());
+        } else {
+            // All centroids are the same, split in the middle
+            split = begin + count / 2;
+        }
+    }
+
+    if(split != begin && split != end) {
+        build_node(begin, split, centroids);
+        build_node(split, end, centroids);
+    }
+
+    _nodes[node_index] = Node {
+        node_bounds.min, begin,
+        node_bounds.max, u32(_nodes.size())
+    };
+}
+
+void BVH::cull(const Frustum& frustum, const glm::vec3& camera_position, std::vector<u32>& visible) const {
+    const glm::vec3 normals[] = {
+        frustum._near_normal,
+        frustum._top_normal,
+        frustum._bottom_normal,
+        frustum._right_normal,
+        frustum._left_normal,
+    };
+
+    float offsets[std::size(normals)] = {};
+    for(size_t i = 0; i != std::size(normals); ++i) {
+        offsets[i] = -glm::dot(normals[i], camera_position);
+    }
+
+    enum class Side { Outside, Intersect, Inside };
+    auto classify = [&](const glm::vec3& box_min, const glm::vec3& box_max) {
+        const glm::vec3 center = (box_min + box_max) * 0.5f;
+        const glm::vec3 half_extent = (box_max - box_min) * 0.5f;
+
+        Side side = Side::Inside;
+        for(size_t i = 0; i != std::size(normals); ++i) {
+            const float dist = glm::dot(normals[i], center) + offsets[i];
+            const float radius = glm::dot(glm::abs(normals[i]), half_extent);
+            if(dist + radius < 0.0f) {
+                return Side::Outside;
+            }
+            if(dist - radius < 0.0f) {
+                side = Side::Intersect;
+            }
+        }
+        return side;
+    };
+
+    for(u32 i = 0; i < _nodes.size();) {
+        const Node& node = _nodes[i];
+        const Side side = classify(node.min, node.max);
+
+        if(side == Side::Outside) {
+            i = node.skip;
+            continue;
+        }
+
+        const bool is_leaf = node.skip == i + 1;
+        if(side == Side::Inside || is_leaf) {
+            const u32 end = item_end(i);
+            for(u32 k = node.first_item; k != end; ++k) {
+                if(side == Side::Inside || classify(_item_bounds[k].min, _item_bounds[k].max) != Side::Outside) {
+                    visible.push_back(_items[k]);
+                }
+            }
+            i = node.skip;
+            continue;
+        }
+
+        ++i;
+    }
+}
+
+Result<RayHit> BVH::intersect(const Ray& ray) const {
+    const glm::vec3 inv_dir = 1.0f / ray.direction;
+
+    RayHit hit = {};
+    hit.distance = std::numeric_limits<float>::infinity();
+
+    for(u32 i = 0; i < _nodes.size();) {
+        const Node& node = _nodes[i];
+        if(intersect_box(ray, inv_dir, node.min, node.max) >= hit.distance) {
+            i = node.skip;
+            continue;
+        }
+
+        if(node.skip == i + 1) {
+            const u32 end = item_end(i);
+            for(u32 k = node.first_item; k != end; ++k) {
+                const float dist = intersect_box(ray, inv_dir, _item_bounds[k].min, _item_bounds[k].max);
+                if(dist < hit.distance) {
+                    hit = RayHit{_items[k], dist};
+                }
+            }
+            i = node.skip;
+            continue;
+        }
+
+        ++i;
+    }
+
+    if(hit.distance == std::numeric_limits<float>::infinity()) {
+        return {false, {}};
+    }
+    return {true, hit};
+}
+
+}
@@ -0,0 +1,61 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <AABB.h>
+#include <Camera.h>
+
+#include <vector>
+
+namespace OM3D {
+
+struct Ray {
+    glm::vec3 origin;
+    glm::vec3 direction;
+};
+
+struct RayHit {
+    u32 item;
+    float distance;
+};
+
+// Bounding volume hierarchy over a set of boxes, built with binned SAH.
+// Nodes are stored in depth-first order: the left child of a node directly follows it, and each node
+// stores the index of the first node after its subtree, so traversal needs no stack.
+// Items are reordered so every subtree covers a contiguous range of them.
+class BVH {
+
+    public:
+        struct Node {
+            glm::vec3 min;
+            u32 first_item;
+            glm::vec3 max;
+            u32 skip;
+        };
+
+        static_assert(sizeof(Node) == 32);
+
+        BVH() = default;
+        BVH(Span<const AABB> bounds);
+
+        bool is_empty() const;
+        size_t item_count() const;
+        size_t node_count() const;
+
+        // Appends the indices of every item whose box intersects the frustum (in no particular order)
+        void cull(const Frustum& frustum, const glm::vec3& camera_position, std::vector<u32>& visible) const;
+
+        // Returns the closest item whose box is hit by the ray
+        Result<RayHit> intersect(const Ray& ray) const;
+
+    private:
+        void build_node(u32 begin, u32 end, std::vector<glm::vec3>& centroids);
+        u32 item_end(u32 node_index) const;
+
+        std::vector<Node> _nodes;
+        std::vector<u32> _items;
+        std::vector<AABB> _item_bounds;
+};
+
+}
+
+#endif // BVH_H
@@ -0,0 +1,212 @@
+#include "BoundsTable.h"
+
+#include <ThreadPool.h>
+
+#include <algorithm>
+#include <limits>
+
+#if defined(SIMD_SSE) || defined(SIMD_AVX)
+#include <immintrin.h>
+#endif
+
+namespace OM3D {
+
+static constexpr size_t plane_count = 5;
+
+// Below this many spheres, waking up workers costs more than culling on a single thread
+static constexpr size_t parallel_threshold = 16 * 1024;
+static constexpr size_t chunk_size = 4 * 1024;
+
+static_assert(chunk_size % BoundsTable::lane_count == 0);
+
+struct CullingPlanes {
+    float x[plane_count];
+    float y[plane_count];
+    float z[plane_count];
+    float w[plane_count];
+};
+
+struct CullingInput {
+    const float* center_x;
+    const float* center_y;
+    const float* center_z;
+    const float* radius;
+};
+
+static CullingPlanes build_planes(const Frustum& frustum, const glm::vec3& camera_position) {
+    const glm::vec3 normals[] = {
+        frustum._near_normal,
+        frustum._top_normal,
+        frustum._bottom_normal,
+        frustum._right_normal,
+        frustum._left_normal,
+    };
+    static_assert(std::size(normals) == plane_count);
+
+    CullingPlanes planes = {};
+    for(size_t i = 0; i != plane_count; ++i) {
+        planes.x[i] = normals[i].x;
+        planes.y[i] = normals[i].y;
+        planes.z[i] = normals[i].z;
+        planes.w[i] = -glm::dot(normals[i], camera_position);
+    }
+    return planes;
+}
+
+// Each function culls [begin; end) and writes visible indices starting at out, returning how many were written.
+// begin and end must be multiples of the lane count, out must have room for end - begin indices.
+
+[[maybe_unused]]
+static size_t cull_range_scalar(const CullingPlanes& planes, const CullingInput& in, size_t begin, size_t end, u32* out) {
+    size_t count = 0;
+    for(size_t i = begin; i != end; ++i) {
+        bool visible = true;
+        for(size_t p = 0; p != plane_count; ++p) {
+            const float dist = in.center_x[i] * planes.x[p] + in.center_y[i] * planes.y[p] + in.center_z[i] * planes.z[p] + planes.w[p];
+            visible &= dist + in.radius[i] >= 0.0f;
+        }
+        out[count] = u32(i);
+        count += visible;
+    }
+    return count;
+}
+
+#ifdef SIMD_SSE
+[[maybe_unused]]
+static size_t cull_range_sse(const CullingPlanes& planes, const CullingInput& in, size_t begin, size_t end, u32* out) {
+    const __m128 zero = _mm_setzero_ps();
+
+    size_t count = 0;
+    for(size_t i = begin; i != end; i += 4) {
+        const __m128 x = _mm_loadu_ps(in.center_x + i);
+        const __m128 y = _mm_loadu_ps(in.center_y + i);
+        const __m128 z = _mm_loadu_ps(in.center_z + i);
+        const __m128 r = _mm_loadu_ps(in.radius + i);
+
+        __m128 visible = _mm_cmpeq_ps(zero, zero);
+        for(size_t p = 0; p != plane_count; ++p) {
+            __m128 dist = _mm_add_ps(_mm_set1_ps(planes.w[p]), r);
+            dist = _mm_add_ps(dist, _mm_mul_ps(x, _mm_set1_ps(planes.x[p])));
+            dist = _mm_add_ps(dist, _mm_mul_ps(y, _mm_set1_ps(planes.y[p])));
+            dist = _mm_add_ps(dist, _mm_mul_ps(z, _mm_set1_ps(planes.z[p])));
+            visible = _mm_and_ps(visible, _mm_cmpge_ps(dist, zero));
+        }
+
+        const u32 mask = u32(_mm_movemask_ps(visible));
+        for(u32 k = 0; k != 4; ++k) {
+            out[count] = u32(i + k);
+            count += (mask >> k) & 1;
+        }
+    }
+    return count;
+}
+#endif
+
+#ifdef SIMD_AVX
+[[maybe_unused]]
+static size_t cull_range_avx(const CullingPlanes& planes, const CullingInput& in, size_t begin, size_t end, u32* out) {
+    const __m256 zero = _mm256_setzero_ps();
+
+    size_t count = 0;
+    for(size_t i = begin; i != end; i += 8) {
+        const __m256 x = _mm256_loadu_ps(in.center_x + i);
+        const __m256 y = _mm256_loadu_ps(in.center_y + i);
+        const __m256 z = _mm256_loadu_ps(in.center_z + i);
+        const __m256 r = _mm256_loadu_ps(in.radius + i);
+
+        __m256 visible = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+        for(size_t p = 0; p != plane_count; ++p) {
+            __m256 dist = _mm256_add_ps(_mm256_set1_ps(planes.w[p]), r);
+            dist = _mm256_add_ps(dist, _mm256_mul_ps(x, _mm256_set1_ps(planes.x[p])));
+            dist = _mm256_add_ps(dist, _mm256_mul_ps(y, _mm256_set1_ps(planes.y[p])));
+            dist = _mm256_add_ps(dist, _mm256_mul_ps(z, _mm256_set1_ps(planes.z[p])));
+            visible = _mm256_and_ps(visible, _mm256_cmp_ps(dist, zero, _CMP_GE_OQ));
+        }
+
+        const u32 mask = u32(_mm256_movemask_ps(visible));
+        for(u32 k = 0; k != 8; ++k) {
+            out[count] = u32(i + k);
+            count += (mask >> k) & 1;
+        }
+    }
+    return count;
+}
+#endif
+
+static size_t cull_range(const CullingPlanes& planes, const CullingInput& in, size_t begin, size_t end, u32* out) {
+#if defined(SIMD_AVX)
+    return cull_range_avx(planes, in, begin, end, out);
+#elif defined(SIMD_SSE)
+    return cull_range_sse(planes, in, begin, end, out);
+#else
+    return cull_range_scalar(planes, in, begin, end, out);
+#endif
+}
+
+
+
+size_t BoundsTable::size() const {
+    return _size;
+}
+
+void BoundsTable::clear() {
+    _center_x.clear();
+    _center_y.clear();
+    _center_z.clear();
+    _radius.clear();
+    _size = 0;
+}
+
+void BoundsTable::push_back(const glm::vec3& center, float radius) {
+    if(_size == _radius.size()) {
+        const size_t padded_size = _size + lane_count;
+        _center_x.resize(padded_size, 0.0f);
+        _center_y.resize(padded_size, 0.0f);
+        _center_z.resize(padded_size, 0.0f);
+        _radius.resize(padded_size, -std::numeric_limits<float>::infinity());
+    }
+    set(_size++, center, radius);
+}
+
+void BoundsTable::set(size_t index, const glm::vec3& center, float radius) {
+    DEBUG_ASSERT(index < _radius.size());
+    _center_x[index] = center.x;
+    _center_y[index] = center.y;
+    _center_z[index] = center.z;
+    _radius[index] = radius;
+}
+
+void BoundsTable::cull(const Frustum& frustum, const glm::vec3& camera_position, std::vector<u32>& visible) const {
+    const CullingPlanes planes = build_planes(frustum, camera_position);
+    const CullingInput in = {
+        _center_x.data(),
+        _center_y.data(),
+        _center_z.data(),
+        _radius.data(),
+    };
+
+    const size_t padded_size = _radius.size();
+    visible.resize(padded_size);
+
+    if(padded_size < parallel_threshold) {
+        visible.resize(cull_range(planes, in, 0, padded_size, visible.data()));
+        return;
+    }
+
+    // Every chunk writes in place, at its own offset, then chunks are compacted in order
+    const size_t chunk_count = (padded_size + chunk_size - 1) / chunk_size;
+    std::vector<size_t> chunk_visible(chunk_count);
+    ThreadPool::global().parallel_for(padded_size, chunk_size, [&](size_t begin, size_t end) {
+        chunk_visible[begin / chunk_size] = cull_range(planes, in, begin, end, visible.data() + begin);
+    });
+
+    size_t count = chunk_visible[0];
+    for(size_t i = 1; i != chunk_count; ++i) {
+        const auto chunk_begin = visible.begin() + i * chunk_size;
+        std::copy(chunk_begin, chunk_begin + chunk_visible[i], visible.begin() + count);
+        count += chunk_visible[i];
+    }
+    visible.resize(count);
+}
+
+}
@@ -0,0 +1,37 @@
+#ifndef BOUNDSTABLE_H
+#define BOUNDSTABLE_H
+
+#include <Camera.h>
+
+#include <vector>
+
+namespace OM3D {
+
+// Structure-of-arrays storage of world space bounding spheres, laid out for SIMD culling.
+// Arrays are padded to a multiple of lane_count with spheres that never pass culling.
+class BoundsTable {
+
+    public:
+        static constexpr size_t lane_count = 8;
+
+        size_t size() const;
+
+        void clear();
+        void push_back(const glm::vec3& center, float radius);
+        void set(size_t index, const glm::vec3& center, float radius);
+
+        // Fills visible with the (sorted) indices of the spheres intersecting the frustum
+        void cull(const Frustum& frustum, const glm::vec3& camera_position, std::vector<u32>& visible) const;
+
+    private:
+        std::vector<float> _center_x;
+        std::vector<float> _center_y;
+        std::vector<float> _center_z;
+        std::vector<float> _radius;
+
+        size_t _size = 0;
+};
+
+}
+
+#endif // BOUNDSTABLE_H
@@ -48,6 +48,9 @@ class BufferMapping : BufferMappingBase {
         template<typename U>
         friend class TypedBuffer;
 
+        template<typename U>
+        friend class RingBuffer;
+
         BufferMapping(void* data, size_t size, const GLHandle& handle) {
             _data = data;
             _byte_size = size;
@@ -12,9 +12,20 @@ static GLuint create_buffer_handle() {
     return handle;
 }
 
-ByteBuffer::ByteBuffer(const void* data, size_t size) : _handle(create_buffer_handle()), _size(size) {
+ByteBuffer::ByteBuffer(const void* data, size_t size, BufferStorage storage) : _handle(create_buffer_handle()), _size(size) {
     ALWAYS_ASSERT(_size, "Buffer size can not be 0");
-    glNamedBufferData(_handle.get(), size, data, GL_STATIC_DRAW);
+    switch(storage) {
+        case BufferStorage::Static:
+            glNamedBufferData(_handle.get(), size, data, GL_STATIC_DRAW);
+        break;
+
+        case BufferStorage::PersistentWrite: {
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glNamedBufferStorage(_handle.get(), size, data, flags);
+            _persistent_mapping = glMapNamedBufferRange(_handle.get(), 0, size, flags);
+            ALWAYS_ASSERT(_persistent_mapping, "Unable to map buffer");
+        } break;
+    }
 }
 
 ByteBuffer::~ByteBuffer() {
@@ -32,19 +43,56 @@ void ByteBuffer::bind(BufferUsage usage, u32 index) const {
     glBindBufferBase(buffer_usage_to_gl(usage), index, _handle.get());
 }
 
+void ByteBuffer::bind(BufferUsage usage, u32 index, size_t byte_offset, size_t byte_size) const {
+    ALWAYS_ASSERT(usage == BufferUsage::Uniform || usage == BufferUsage::Storage, "Index bind is only available for uniform and storage buffers");
+    DEBUG_ASSERT(byte_offset + byte_size <= _size);
+    glBindBufferRange(buffer_usage_to_gl(usage), index, _handle.get(), byte_offset, byte_size);
+}
+
+void ByteBuffer::bind_vertex_buffer(u32 binding_index, size_t stride) const {
+    glBindVertexBuffer(binding_index, _handle.get(), 0, GLsizei(stride));
+}
+
 size_t ByteBuffer::byte_size() const {
     return _size;
 }
 
+void ByteBuffer::write(size_t byte_offset, const void* data, size_t byte_size) {
+    DEBUG_ASSERT(byte_offset + byte_size <= _size);
+    glNamedBufferSubData(_handle.get(), byte_offset, byte_size, data);
+}
+
+void ByteBuffer::copy_to(ByteBuffer& dst, size_t byte_size) const {
+    DEBUG_ASSERT(byte_size <= _size && byte_size <= dst._size);
+    glCopyNamedBufferSubData(_handle.get(), dst._handle.get(), 0, 0, byte_size);
+}
+
+void ByteBuffer::read(size_t byte_offset, void* data, size_t byte_size) const {
+    DEBUG_ASSERT(byte_offset + byte_size <= _size);
+    glGetNamedBufferSubData(_handle.get(), byte_offset, byte_size, data);
+}
+
 BufferMapping<byte> ByteBuffer::map_bytes(AccessType access) {
     return BufferMapping<byte>(map_internal(access), byte_size(), handle());
 }
 
+void* ByteBuffer::persistent_mapping() const {
+    DEBUG_ASSERT(_persistent_mapping);
+    return _persistent_mapping;
+}
+
 void* ByteBuffer::map_internal(AccessType access) {
     DEBUG_ASSERT(_handle.is_valid() && _size);
+    DEBUG_ASSERT(!_persistent_mapping);
     return glMapNamedBuffer(_handle.get(), access_type_to_gl(access));
 }
 
+void* ByteBuffer::map_range_internal(size_t byte_offset, size_t byte_size) {
+    DEBUG_ASSERT(_handle.is_valid() && byte_size && byte_offset + byte_size <= _size);
+    DEBUG_ASSERT(!_persistent_mapping);
+    return glMapNamedBufferRange(_handle.get(), byte_offset, byte_size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+}
+
 const GLHandle& ByteBuffer::handle() const {
     return _handle;
 }
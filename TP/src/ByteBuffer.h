@@ -13,23 +13,36 @@ class ByteBuffer : NonCopyable {
         ByteBuffer(ByteBuffer&&) = default;
         ByteBuffer& operator=(ByteBuffer&&) = default;
 
-        ByteBuffer(const void* data, size_t size);
+        ByteBuffer(const void* data, size_t size, BufferStorage storage = BufferStorage::Static);
         ~ByteBuffer();
 
         void bind(BufferUsage usage) const;
         void bind(BufferUsage usage, u32 index) const;
+        void bind(BufferUsage usage, u32 index, size_t byte_offset, size_t byte_size) const;
+        void bind_vertex_buffer(u32 binding_index, size_t stride) const;
 
         size_t byte_size() const;
 
+        void write(size_t byte_offset, const void* data, size_t byte_size);
+        void copy_to(ByteBuffer& dst, size_t byte_size) const;
+        // Waits for the GPU if it still has to write the buffer
+        void read(size_t byte_offset, void* data, size_t byte_size) const;
+
         BufferMapping<byte> map_bytes(AccessType access = AccessType::ReadWrite);
 
+        // Only valid for BufferStorage::PersistentWrite buffers
+        void* persistent_mapping() const;
+
     protected:
         void* map_internal(AccessType access);
+        // Write only, the previous content of the range is discarded
+        void* map_range_internal(size_t byte_offset, size_t byte_size);
         const GLHandle& handle() const;
 
     private:
         GLHandle _handle;
         size_t _size = 0;
+        void* _persistent_mapping = nullptr;
 };
 
 }
@@ -62,6 +62,13 @@ glm::vec3 Camera::up() const {
     return extract_up(_view);
 }
 
+glm::vec3 Camera::ray_direction(const glm::vec2& ndc) const {
+    const glm::vec3 dir = forward()
+        + right() * (ndc.x / _projection[0][0])
+        + up() * (ndc.y / _projection[1][1]);
+    return glm::normalize(dir);
+}
+
 const glm::mat4& Camera::projection_matrix() const {
     return _projection;
 }
@@ -104,4 +111,22 @@ Frustum Camera::build_frustum() const {
     return frustum;
 }
 
+bool intersects(const Frustum& frustum, const glm::vec3& camera_position, const glm::vec3& center, float radius) {
+    const glm::vec3 to_center = center - camera_position;
+    const glm::vec3 normals[] = {
+        frustum._near_normal,
+        frustum._top_normal,
+        frustum._bottom_normal,
+        frustum._right_normal,
+        frustum._left_normal,
+    };
+
+    for(const glm::vec3& normal : normals) {
+        if(glm::dot(normal, to_center) < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
 }
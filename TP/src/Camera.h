@@ -16,6 +16,9 @@ struct Frustum {
     glm::vec3 _left_normal;
 };
 
+// Plane normals point inside the frustum and all planes go through the camera position
+bool intersects(const Frustum& frustum, const glm::vec3& camera_position, const glm::vec3& center, float radius);
+
 
 class Camera {
     public:
@@ -29,6 +32,9 @@ class Camera {
         glm::vec3 right() const;
         glm::vec3 up() const;
 
+        // World space direction of the ray going through the given point in normalized device coordinates
+        glm::vec3 ray_direction(const glm::vec2& ndc) const;
+
         const glm::mat4& projection_matrix() const;
         const glm::mat4& view_matrix() const;
         const glm::mat4& view_proj_matrix() const;
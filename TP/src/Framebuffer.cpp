@@ -54,12 +54,12 @@ Framebuffer::~Framebuffer() {
 }
 
 
-void Framebuffer::bind(bool clear) const {
+void Framebuffer::bind(bool clear, bool clear_depth) const {
     glBindFramebuffer(GL_FRAMEBUFFER, _handle.get());
     glViewport(0, 0, _size.x, _size.y);
 
     if(clear) {
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glClear(clear_depth ? GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT : GL_COLOR_BUFFER_BIT);
     }
 }
 
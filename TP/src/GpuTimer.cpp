@@ -0,0 +1,38 @@
+#include "GpuTimer.h"
+
+#include <glad/glad.h>
+
+namespace OM3D {
+
+GpuTimer::GpuTimer() {
+    glCreateQueries(GL_TIME_ELAPSED, query_count, _queries.data());
+}
+
+GpuTimer::~GpuTimer() {
+    glDeleteQueries(query_count, _queries.data());
+}
+
+void GpuTimer::begin() {
+    const u32 query = _queries[_frame % query_count];
+    if(_frame >= query_count) {
+        GLint available = 0;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if(available) {
+            GLuint64 nanoseconds = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+            _elapsed = double(nanoseconds) * 1e-9;
+        }
+    }
+    glBeginQuery(GL_TIME_ELAPSED, query);
+}
+
+void GpuTimer::end() {
+    glEndQuery(GL_TIME_ELAPSED);
+    ++_frame;
+}
+
+double GpuTimer::elapsed() const {
+    return _elapsed;
+}
+
+}
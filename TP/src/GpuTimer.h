@@ -0,0 +1,34 @@
+#ifndef GPUTIMER_H
+#define GPUTIMER_H
+
+#include <graphics.h>
+
+#include <array>
+
+namespace OM3D {
+
+// Measures the GPU time spent between begin() and end() using timer queries.
+// Results are fetched query_count frames later so reading them never stalls: they lag behind a little.
+class GpuTimer : NonMovable {
+
+    public:
+        GpuTimer();
+        ~GpuTimer();
+
+        void begin();
+        void end();
+
+        // Last available measure, in seconds
+        double elapsed() const;
+
+    private:
+        static constexpr u32 query_count = 3;
+
+        std::array<u32, query_count> _queries = {};
+        u32 _frame = 0;
+        double _elapsed = 0.0;
+};
+
+}
+
+#endif // GPUTIMER_H
@@ -0,0 +1,59 @@
+#include "HiZ.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+
+namespace OM3D {
+
+static glm::uvec2 half_size(const glm::uvec2& size) {
+    return glm::max(size / 2u, glm::uvec2(1));
+}
+
+HiZ::HiZ(const glm::uvec2& depth_size) :
+    _depth_size(depth_size),
+    _mip_count(Texture::mip_levels(half_size(depth_size))),
+    _texture(half_size(depth_size), ImageFormat::R32_FLOAT, _mip_count),
+    _program(Program::from_file("hiz.comp")) {
+}
+
+bool HiZ::is_null() const {
+    return !_mip_count;
+}
+
+void HiZ::build(const Texture& depth) {
+    _program->bind();
+
+    glm::uvec2 size = half_size(_depth_size);
+    for(u32 level = 0; level != _mip_count; ++level) {
+        // Level 0 reduces the depth buffer itself, every other level reduces the previous one
+        if(level) {
+            _texture.bind(0);
+            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+        } else {
+            depth.bind(0);
+        }
+
+        _program->set_uniform(HASH("src_level"), level ? level - 1 : 0u);
+        _texture.bind_as_image(1, AccessType::WriteOnly, level);
+        glDispatchCompute(align_up_to(size.x, 8) / 8, align_up_to(size.y, 8) / 8, 1);
+
+        size = half_size(size);
+    }
+
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+}
+
+void HiZ::bind(u32 index) const {
+    _texture.bind(index);
+}
+
+const glm::uvec2& HiZ::depth_size() const {
+    return _depth_size;
+}
+
+u32 HiZ::mip_count() const {
+    return _mip_count;
+}
+
+}
@@ -0,0 +1,36 @@
+#ifndef HIZ_H
+#define HIZ_H
+
+#include <Texture.h>
+#include <Program.h>
+
+namespace OM3D {
+
+// Hierarchical depth buffer built from a reverse-Z depth buffer.
+// Level 0 is half the resolution of the depth buffer and every texel of every level holds the farthest
+// (smallest) depth of the area it covers, so an object whose nearest depth is smaller is hidden.
+class HiZ {
+
+    public:
+        HiZ() = default;
+        HiZ(const glm::uvec2& depth_size);
+
+        bool is_null() const;
+
+        void build(const Texture& depth);
+        void bind(u32 index) const;
+
+        const glm::uvec2& depth_size() const;
+        u32 mip_count() const;
+
+    private:
+        glm::uvec2 _depth_size = {};
+        u32 _mip_count = 0;
+
+        Texture _texture;
+        std::shared_ptr<Program> _program;
+};
+
+}
+
+#endif // HIZ_H
@@ -2,6 +2,12 @@
 
 #include <glad/glad.h>
 
+// From EXT_texture_compression_s3tc and EXT_texture_sRGB, which every desktop driver exposes but the loader doesn't
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT        0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT        0x83F3
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT  0x8C4D
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT  0x8C4F
+
 namespace OM3D {
 
 ImageFormatGL image_format_to_gl(ImageFormat format) {
@@ -10,11 +16,67 @@ ImageFormatGL image_format_to_gl(ImageFormat format) {
         case ImageFormat::RGBA8_sRGB:       return ImageFormatGL{ GL_RGBA, GL_SRGB8_ALPHA8, GL_UNSIGNED_BYTE };
         case ImageFormat::RGB8_UNORM:       return ImageFormatGL{ GL_RGB, GL_RGB8, GL_UNSIGNED_BYTE };
         case ImageFormat::RGB8_sRGB:        return ImageFormatGL{ GL_RGB, GL_SRGB8, GL_UNSIGNED_BYTE };
+        case ImageFormat::RG8_UNORM:        return ImageFormatGL{ GL_RG, GL_RG8, GL_UNSIGNED_BYTE };
+        case ImageFormat::RG16_UNORM:       return ImageFormatGL{ GL_RG, GL_RG16, GL_UNSIGNED_SHORT };
         case ImageFormat::RGBA16_FLOAT:     return ImageFormatGL{ GL_RGBA, GL_RGBA16F, GL_FLOAT };
+        case ImageFormat::R11G11B10_FLOAT:  return ImageFormatGL{ GL_RGB, GL_R11F_G11F_B10F, GL_FLOAT };
+        case ImageFormat::R32_FLOAT:        return ImageFormatGL{ GL_RED, GL_R32F, GL_FLOAT };
         case ImageFormat::Depth32_FLOAT:    return ImageFormatGL{ GL_DEPTH_COMPONENT, GL_DEPTH_COMPONENT32F, GL_FLOAT };
+        // Uploads of compressed formats take the internal format
+        case ImageFormat::BC1_UNORM:        return ImageFormatGL{ GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, GL_UNSIGNED_BYTE };
+        case ImageFormat::BC1_sRGB:         return ImageFormatGL{ GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT, GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT, GL_UNSIGNED_BYTE };
+        case ImageFormat::BC3_UNORM:        return ImageFormatGL{ GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, GL_UNSIGNED_BYTE };
+        case ImageFormat::BC3_sRGB:         return ImageFormatGL{ GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT, GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT, GL_UNSIGNED_BYTE };
+        case ImageFormat::BC5_UNORM:        return ImageFormatGL{ GL_COMPRESSED_RG_RGTC2, GL_COMPRESSED_RG_RGTC2, GL_UNSIGNED_BYTE };
     }
 
     FATAL("Unknown image format");
 }
 
+u32 bytes_per_pixel(ImageFormat format) {
+    switch(format) {
+        case ImageFormat::RGBA8_UNORM:      return 4;
+        case ImageFormat::RGBA8_sRGB:       return 4;
+        case ImageFormat::RGB8_UNORM:       return 3;
+        case ImageFormat::RGB8_sRGB:        return 3;
+        case ImageFormat::RG8_UNORM:        return 2;
+        case ImageFormat::RG16_UNORM:       return 4;
+        case ImageFormat::RGBA16_FLOAT:     return 8;
+        case ImageFormat::R11G11B10_FLOAT:  return 4;
+        case ImageFormat::R32_FLOAT:        return 4;
+        case ImageFormat::Depth32_FLOAT:    return 4;
+
+        case ImageFormat::BC1_UNORM:
+        case ImageFormat::BC1_sRGB:
+        case ImageFormat::BC3_UNORM:
+        case ImageFormat::BC3_sRGB:
+        case ImageFormat::BC5_UNORM:        FATAL("Block compressed formats have no size per pixel");
+    }
+
+    FATAL("Unknown image format");
+}
+
+static u32 bytes_per_block(ImageFormat format) {
+    switch(format) {
+        case ImageFormat::BC1_UNORM:        return 8;
+        case ImageFormat::BC1_sRGB:         return 8;
+        case ImageFormat::BC3_UNORM:        return 16;
+        case ImageFormat::BC3_sRGB:         return 16;
+        case ImageFormat::BC5_UNORM:        return 16;
+
+        default:                            return 0;
+    }
+}
+
+bool is_block_compressed(ImageFormat format) {
+    return bytes_per_block(format) != 0;
+}
+
+size_t image_byte_size(ImageFormat format, u32 width, u32 height) {
+    if(const u32 block_bytes = bytes_per_block(format)) {
+        return size_t((width + 3) / 4) * ((height + 3) / 4) * block_bytes;
+    }
+    return size_t(width) * height * bytes_per_pixel(format);
+}
+
 }
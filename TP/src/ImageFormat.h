@@ -11,8 +11,20 @@ enum class ImageFormat {
     RGB8_UNORM,
     RGB8_sRGB,
 
+    RG8_UNORM,
+    RG16_UNORM,
+
     RGBA16_FLOAT,
-    Depth32_FLOAT
+    R11G11B10_FLOAT,
+    R32_FLOAT,
+    Depth32_FLOAT,
+
+    // Compressed in 4x4 blocks of 8 (BC1) or 16 bytes, sampling only
+    BC1_UNORM,
+    BC1_sRGB,
+    BC3_UNORM,
+    BC3_sRGB,
+    BC5_UNORM
 };
 
 
@@ -23,6 +35,12 @@ struct ImageFormatGL {
 };
 
 ImageFormatGL image_format_to_gl(ImageFormat format);
+// Not defined for block compressed formats
+u32 bytes_per_pixel(ImageFormat format);
+
+bool is_block_compressed(ImageFormat format);
+// Size of a width x height image, in whole blocks for block compressed formats
+size_t image_byte_size(ImageFormat format, u32 width, u32 height);
 
 }
 
@@ -0,0 +1,36 @@
+#include "LightClusters.h"
+
+#include <glad/glad.h>
+
+namespace OM3D {
+
+// Average number of lights per cluster the index buffer has room for
+static constexpr u32 average_cluster_lights = 16;
+
+LightClusters::LightClusters(const glm::uvec2& screen_size) :
+    _tile_count((screen_size + shader::cluster_tile_size - 1u) / shader::cluster_tile_size),
+    _program(Program::from_file("light_cull.comp")) {
+
+    const size_t cluster_count = size_t(_tile_count.x) * _tile_count.y * shader::cluster_slice_count;
+    _clusters = TypedBuffer<shader::LightCluster>(nullptr, cluster_count);
+    _light_indices = TypedBuffer<u32>(nullptr, 1 + cluster_count * average_cluster_lights);
+}
+
+void LightClusters::build(const Texture& depth) {
+    const u32 index_count = 0;
+    _light_indices.write(0, &index_count, sizeof(index_count));
+
+    _program->bind();
+    depth.bind(0);
+    bind();
+    glDispatchCompute(_tile_count.x, _tile_count.y, 1);
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void LightClusters::bind() const {
+    _clusters.bind(BufferUsage::Storage, 2);
+    _light_indices.bind(BufferUsage::Storage, 3);
+}
+
+}
@@ -0,0 +1,40 @@
+#ifndef LIGHTCLUSTERS_H
+#define LIGHTCLUSTERS_H
+
+#include <shader_structs.h>
+
+#include <Texture.h>
+#include <Program.h>
+#include <TypedBuffer.h>
+
+namespace OM3D {
+
+// Per cluster light lists for the lighting pass, see cluster_tile_size and cluster_slice_count in structs.glsl
+class LightClusters : NonCopyable {
+
+    public:
+        LightClusters() = default;
+        LightClusters(LightClusters&&) = default;
+        LightClusters& operator=(LightClusters&&) = default;
+
+        LightClusters(const glm::uvec2& screen_size);
+
+        // Bins the lights bound at storage 1, using the frame data bound at uniform 0 and the depth buffer of the frame
+        void build(const Texture& depth);
+
+        // Binds the clusters (storage 2) and their light indices (storage 3)
+        void bind() const;
+
+    private:
+        glm::uvec2 _tile_count = {};
+
+        TypedBuffer<shader::LightCluster> _clusters;
+        // Index count followed by the indices
+        TypedBuffer<u32> _light_indices;
+
+        std::shared_ptr<Program> _program;
+};
+
+}
+
+#endif // LIGHTCLUSTERS_H
@@ -0,0 +1,150 @@
+#include "LightVolumes.h"
+
+#include <glad/glad.h>
+
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+
+namespace OM3D {
+
+// Subdivided icosahedron whose faces all lie outside of the unit sphere
+static MeshData create_icosphere(u32 subdivisions) {
+    const float t = (1.0f + std::sqrt(5.0f)) * 0.5f;
+    std::vector<glm::vec3> positions = {
+        {-1.0f, t, 0.0f}, {1.0f, t, 0.0f}, {-1.0f, -t, 0.0f}, {1.0f, -t, 0.0f},
+        {0.0f, -1.0f, t}, {0.0f, 1.0f, t}, {0.0f, -1.0f, -t}, {0.0f, 1.0f, -t},
+        {t, 0.0f, -1.0f}, {t, 0.0f, 1.0f}, {-t, 0.0f, -1.0f}, {-t, 0.0f, 1.0f},
+    };
+    std::vector<u32> indices = {
+        0, 11, 5,   0, 5, 1,    0, 1, 7,    0, 7, 10,   0, 10, 11,
+        1, 5, 9,    5, 11, 4,   11, 10, 2,  10, 7, 6,   7, 1, 8,
+        3, 9, 4,    3, 4, 2,    3, 2, 6,    3, 6, 8,    3, 8, 9,
+        4, 9, 5,    2, 4, 11,   6, 2, 10,   8, 6, 7,    9, 8, 1,
+    };
+
+    for(glm::vec3& p : positions) {
+        p = glm::normalize(p);
+    }
+
+    for(u32 s = 0; s != subdivisions; ++s) {
+        std::map<std::pair<u32, u32>, u32> midpoints;
+        auto midpoint = [&](u32 a, u32 b) {
+            const auto [it, inserted] = midpoints.emplace(std::minmax(a, b), u32(positions.size()));
+            if(inserted) {
+                positions.push_back(glm::normalize(positions[a] + positions[b]));
+            }
+            return it->second;
+        };
+
+        std::vector<u32> subdivided;
+        subdivided.reserve(indices.size() * 4);
+        for(size_t i = 0; i != indices.size(); i += 3) {
+            const u32 a = indices[i];
+            const u32 b = indices[i + 1];
+            const u32 c = indices[i + 2];
+            const u32 ab = midpoint(a, b);
+            const u32 bc = midpoint(b, c);
+            const u32 ca = midpoint(c, a);
+            subdivided.insert(subdivided.end(), {a, ab, ca,  b, bc, ab,  c, ca, bc,  ab, bc, ca});
+        }
+        indices = std::move(subdivided);
+    }
+
+    // Push faces out so that their closest point to the center is on the unit sphere, and make them face outward
+    float min_distance = std::numeric_limits<float>::max();
+    for(size_t i = 0; i != indices.size(); i += 3) {
+        const glm::vec3 a = positions[indices[i]];
+        const glm::vec3 b = positions[indices[i + 1]];
+        const glm::vec3 c = positions[indices[i + 2]];
+        glm::vec3 normal = glm::normalize(glm::cross(b - a, c - a));
+        if(glm::dot(normal, a) < 0.0f) {
+            std::swap(indices[i + 1], indices[i + 2]);
+            normal = -normal;
+        }
+        min_distance = std::min(min_distance, glm::dot(normal, a));
+    }
+
+    MeshData data;
+    data.indices = std::move(indices);
+    data.vertices.resize(positions.size());
+    for(size_t i = 0; i != positions.size(); ++i) {
+        data.vertices[i].position = positions[i] / min_distance;
+        data.vertices[i].normal = positions[i];
+        data.vertices[i].uv = glm::vec2(0.0f);
+    }
+    return data;
+}
+
+LightVolumes::LightVolumes(std::shared_ptr<Texture> color, std::shared_ptr<Texture> normal, std::shared_ptr<Texture> depth) {
+    const MeshData sphere = create_icosphere(1);
+
+    // Circumscribed radius, the farthest vertex from the center
+    _sphere_radius = 0.0f;
+    for(const auto& vertex : sphere.vertices) {
+        _sphere_radius = std::max(_sphere_radius, glm::length(vertex.position));
+    }
+    _sphere = StaticMesh(sphere);
+
+    const auto program = Program::from_files("light_volume.frag", "light_volume.vert");
+    for(Material* material : {&_outside_material, &_inside_material}) {
+        material->set_program(program);
+        material->set_texture(0u, color);
+        material->set_texture(1u, normal);
+        material->set_texture(2u, depth);
+        material->set_blend_mode(BlendMode::Additive);
+        material->set_depth_write(false);
+    }
+
+    // Front faces in front of the scene
+    _outside_material.set_depth_test_mode(DepthTestMode::Standard);
+    // Back faces behind the scene, used when the front faces might be clipped
+    _inside_material.set_depth_test_mode(DepthTestMode::Reversed);
+}
+
+void LightVolumes::set_normal_texture(std::shared_ptr<Texture> normal) {
+    _outside_material.set_texture(1u, normal);
+    _inside_material.set_texture(1u, std::move(normal));
+}
+
+void LightVolumes::render(Span<const shader::PointLight> lights, const glm::vec3& camera_position) {
+    if(lights.is_empty()) {
+        return;
+    }
+
+    if(_light_indices.element_count() < lights.size()) {
+        _light_indices = RingBuffer<u32>(lights.size());
+    }
+
+    u32 outside_count = 0;
+    {
+        auto mapping = _light_indices.map_next();
+        u32 inside_index = u32(lights.size());
+        for(size_t i = 0; i != lights.size(); ++i) {
+            // Keep a margin for the near plane
+            const float radius = lights[i].radius * _sphere_radius * 1.1f + 0.01f;
+            const bool inside = glm::length(lights[i].position - camera_position) < radius;
+            mapping[inside ? --inside_index : outside_count++] = u32(i);
+        }
+    }
+    const u32 inside_count = u32(lights.size()) - outside_count;
+
+    _light_indices.bind(BufferUsage::Storage, 2);
+
+    StateCache cache;
+
+    _outside_material.bind(cache);
+    _outside_material.set_uniform(HASH("light_offset"), 0u);
+    _sphere.draw(cache, outside_count, true);
+
+    glCullFace(GL_FRONT);
+    _inside_material.bind(cache);
+    _inside_material.set_uniform(HASH("light_offset"), outside_count);
+    _sphere.draw(cache, inside_count, true);
+    glCullFace(GL_BACK);
+}
+
+}
@@ -0,0 +1,40 @@
+#ifndef LIGHTVOLUMES_H
+#define LIGHTVOLUMES_H
+
+#include <StaticMesh.h>
+#include <Material.h>
+#include <shader_structs.h>
+#include <RingBuffer.h>
+
+#include <vector>
+
+namespace OM3D {
+
+// Deferred lighting drawing every point light as an instanced sphere, additively blended, so only
+// the pixels covered by a light are shaded. Reads the G-buffer color, normal and depth.
+class LightVolumes : NonMovable {
+
+    public:
+        LightVolumes(std::shared_ptr<Texture> color, std::shared_ptr<Texture> normal, std::shared_ptr<Texture> depth);
+
+        // Frame data (uniform 0) and lights (storage 1) must be bound, in the same order as lights.
+        // The bound framebuffer must use the G-buffer depth, without writing to it.
+        void render(Span<const shader::PointLight> lights, const glm::vec3& camera_position);
+
+        void set_normal_texture(std::shared_ptr<Texture> normal);
+
+    private:
+        StaticMesh _sphere;
+        // Radius of the sphere mesh, whose faces enclose the unit sphere
+        float _sphere_radius = 1.0f;
+
+        Material _outside_material;
+        Material _inside_material;
+
+        // Indices of the lights to draw: lights not containing the camera first
+        RingBuffer<u32> _light_indices;
+};
+
+}
+
+#endif // LIGHTVOLUMES_H
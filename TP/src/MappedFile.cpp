@@ -0,0 +1,94 @@
+#include "MappedFile.h"
+
+#ifdef OS_WIN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace OM3D {
+
+#ifdef OS_WIN
+
+MappedFile::~MappedFile() {
+    if(_data) {
+        UnmapViewOfFile(_data);
+    }
+    if(_mapping) {
+        CloseHandle(_mapping);
+    }
+    if(_file) {
+        CloseHandle(_file);
+    }
+}
+
+Result<std::unique_ptr<MappedFile>> MappedFile::from_file(const std::string& file_name) {
+    auto file = std::unique_ptr<MappedFile>(new MappedFile());
+
+    const HANDLE handle = CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(handle == INVALID_HANDLE_VALUE) {
+        return {false, {}};
+    }
+    file->_file = handle;
+
+    LARGE_INTEGER size = {};
+    if(!GetFileSizeEx(handle, &size) || !size.QuadPart) {
+        return {false, {}};
+    }
+    file->_size = size_t(size.QuadPart);
+
+    file->_mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(!file->_mapping) {
+        return {false, {}};
+    }
+
+    file->_data = static_cast<const u8*>(MapViewOfFile(file->_mapping, FILE_MAP_READ, 0, 0, 0));
+    if(!file->_data) {
+        return {false, {}};
+    }
+
+    return {true, std::move(file)};
+}
+
+#else
+
+MappedFile::~MappedFile() {
+    if(_data) {
+        munmap(const_cast<u8*>(_data), _size);
+    }
+}
+
+Result<std::unique_ptr<MappedFile>> MappedFile::from_file(const std::string& file_name) {
+    const int fd = open(file_name.c_str(), O_RDONLY);
+    if(fd < 0) {
+        return {false, {}};
+    }
+    // The mapping stays valid once the descriptor is closed
+    DEFER(close(fd));
+
+    struct stat info = {};
+    if(fstat(fd, &info) || !info.st_size) {
+        return {false, {}};
+    }
+
+    void* data = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if(data == MAP_FAILED) {
+        return {false, {}};
+    }
+
+    auto file = std::unique_ptr<MappedFile>(new MappedFile());
+    file->_data = static_cast<const u8*>(data);
+    file->_size = size_t(info.st_size);
+    return {true, std::move(file)};
+}
+
+#endif
+
+Span<const u8> MappedFile::data() const {
+    return Span<const u8>(_data, _size);
+}
+
+}
@@ -0,0 +1,35 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <utils.h>
+
+#include <memory>
+#include <string>
+
+namespace OM3D {
+
+// Read only memory mapping of a whole file
+class MappedFile : NonMovable {
+
+    public:
+        ~MappedFile();
+
+        static Result<std::unique_ptr<MappedFile>> from_file(const std::string& file_name);
+
+        Span<const u8> data() const;
+
+    private:
+        MappedFile() = default;
+
+        const u8* _data = nullptr;
+        size_t _size = 0;
+
+#ifdef OS_WIN
+        void* _file = nullptr;
+        void* _mapping = nullptr;
+#endif
+};
+
+}
+
+#endif // MAPPEDFILE_H
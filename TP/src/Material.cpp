@@ -1,8 +1,7 @@
 #include "Material.h"
 
-#include <glad/glad.h>
-
 #include <algorithm>
+#include <array>
 
 namespace OM3D {
 
@@ -26,78 +25,90 @@ void Material::set_depth_write(bool write) {
 }
 
 void Material::set_texture(u32 slot, std::shared_ptr<Texture> tex) {
-    if(const auto it = std::find_if(_textures.begin(), _textures.end(), [&](const auto& t) { return t.second == tex; }); it != _textures.end()) {
+    if(const auto it = std::find_if(_textures.begin(), _textures.end(), [&](const auto& t) { return t.first == slot; }); it != _textures.end()) {
         it->second = std::move(tex);
     } else {
         _textures.emplace_back(slot, std::move(tex));
     }
 }
 
-void Material::bind() const {
-    switch(_blend_mode) {
-        case BlendMode::None:
-            glDisable(GL_BLEND);
-            glEnable(GL_CULL_FACE);
-        break;
-
-        case BlendMode::Alpha:
-            glEnable(GL_BLEND);
-            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-            glDisable(GL_CULL_FACE);
-        break;
-    }
+const std::shared_ptr<Program>& Material::program() const {
+    return _program;
+}
+
+Span<const std::pair<u32, std::shared_ptr<Texture>>> Material::textures() const {
+    return _textures;
+}
+
+bool Material::is_bindless() const {
+    return _bindless;
+}
 
-    switch(_depth_test_mode) {
-        case DepthTestMode::None:
-            glDisable(GL_DEPTH_TEST);
-        break;
-
-        case DepthTestMode::Equal:
-            glEnable(GL_DEPTH_TEST);
-            glDepthFunc(GL_EQUAL);
-        break;
-
-        case DepthTestMode::Standard:
-            glEnable(GL_DEPTH_TEST);
-            // We are using reverse-Z
-            glDepthFunc(GL_GEQUAL);
-        break;
-
-        case DepthTestMode::Reversed:
-            glEnable(GL_DEPTH_TEST);
-            // We are using reverse-Z
-            glDepthFunc(GL_LEQUAL);
-        break;
+bool Material::has_same_binds(const Material& other) const {
+    if(this == &other) {
+        return true;
     }
+    return _bindless && other._bindless &&
+           _program == other._program &&
+           _blend_mode == other._blend_mode &&
+           _depth_test_mode == other._depth_test_mode &&
+           _depth_write == other._depth_write;
+}
+
+void Material::bind() const {
+    // A fresh cache emits every state
+    StateCache cache;
+    bind(cache);
+}
 
-    glDepthMask(_depth_write);
+void Material::bind(StateCache& cache) const {
+    cache.set_blend_mode(_blend_mode);
+    cache.set_depth_test_mode(_depth_test_mode);
+    cache.set_depth_write(_depth_write);
 
-    for(const auto& texture : _textures) {
-        texture.second->bind(texture.first);
+    if(!_bindless) {
+        for(const auto& texture : _textures) {
+            cache.bind_texture(texture.first, *texture.second);
+        }
+    }
+    cache.bind_program(*_program);
+}
+
+// With bindless textures, every G-buffer material of a vertex format shares one program, which checks for textures at runtime
+static std::shared_ptr<Program> gbuffer_program(VertexFormat format, std::vector<std::string> defines) {
+    if(has_bindless_textures()) {
+        defines = {"BINDLESS_TEXTURES"};
+    }
+    if(format == VertexFormat::Compact) {
+        defines.emplace_back("COMPACT_VERTICES");
     }
-    _program->bind();
+    return Program::from_files("gbuffer.frag", "basic.vert", defines);
 }
 
-std::shared_ptr<Material> Material::empty_material() {
-    static std::weak_ptr<Material> weak_material;
+std::shared_ptr<Material> Material::empty_material(VertexFormat format) {
+    static std::array<std::weak_ptr<Material>, 2> weak_materials;
+    auto& weak_material = weak_materials[size_t(format)];
     auto material = weak_material.lock();
     if(!material) {
         material = std::make_shared<Material>();
-        material->_program = Program::from_files("gbuffer.frag", "basic.vert");
+        material->_program = gbuffer_program(format, {});
+        material->_bindless = has_bindless_textures();
         weak_material = material;
     }
     return material;
 }
 
-Material Material::textured_material() {
+Material Material::textured_material(VertexFormat format) {
     Material material;
-    material._program = Program::from_files("gbuffer.frag", "basic.vert", {"TEXTURED"});
+    material._program = gbuffer_program(format, {"TEXTURED"});
+    material._bindless = has_bindless_textures();
     return material;
 }
 
-Material Material::textured_normal_mapped_material() {
+Material Material::textured_normal_mapped_material(VertexFormat format) {
     Material material;
-    material._program = Program::from_files("gbuffer.frag", "basic.vert", std::array<std::string, 2>{"TEXTURED", "NORMAL_MAPPED"});
+    material._program = gbuffer_program(format, {"TEXTURED", "NORMAL_MAPPED"});
+    material._bindless = has_bindless_textures();
     return material;
 }
 
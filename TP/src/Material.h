@@ -3,6 +3,8 @@
 
 #include <Program.h>
 #include <Texture.h>
+#include <StateCache.h>
+#include <Vertex.h>
 
 #include <memory>
 #include <vector>
@@ -12,6 +14,7 @@ namespace OM3D {
 enum class BlendMode {
     None,
     Alpha,
+    Additive,
 };
 
 enum class DepthTestMode {
@@ -32,6 +35,14 @@ class Material {
         void set_depth_write(bool write);
         void set_texture(u32 slot, std::shared_ptr<Texture> tex);
 
+        const std::shared_ptr<Program>& program() const;
+        Span<const std::pair<u32, std::shared_ptr<Texture>>> textures() const;
+
+        // Bindless materials don't bind their textures: shaders fetch them from the material buffer (see Scene).
+        // Materials whose binds are the same can be drawn by the same call.
+        bool is_bindless() const;
+        bool has_same_binds(const Material& other) const;
+
         template<typename... Args>
         void set_uniform(Args&&... args) {
             _program->set_uniform(FWD(args)...);
@@ -39,10 +50,12 @@ class Material {
 
 
         void bind() const;
+        void bind(StateCache& cache) const;
 
-        static std::shared_ptr<Material> empty_material();
-        static Material textured_material();
-        static Material textured_normal_mapped_material();
+        // Materials for meshes of the given vertex format, bindless when supported
+        static std::shared_ptr<Material> empty_material(VertexFormat format = VertexFormat::Standard);
+        static Material textured_material(VertexFormat format = VertexFormat::Standard);
+        static Material textured_normal_mapped_material(VertexFormat format = VertexFormat::Standard);
 
 
     private:
@@ -53,6 +66,7 @@ class Material {
         DepthTestMode _depth_test_mode = DepthTestMode::Standard;
         bool _depth_write = true;
 
+        bool _bindless = false;
 };
 
 }
@@ -0,0 +1,189 @@
+#include "MeshArena.h"
+
+#include <glm/common.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace OM3D {
+
+template<typename T>
+static void grow(TypedBuffer<T>& buffer, size_t count, size_t capacity) {
+    TypedBuffer<T> new_buffer(nullptr, capacity);
+    if(count) {
+        buffer.copy_to(new_buffer, count * sizeof(T));
+    }
+    buffer = std::move(new_buffer);
+}
+
+template<typename T>
+static void append(TypedBuffer<T>& buffer, size_t& count, Span<const T> data) {
+    const size_t needed = count + data.size();
+    if(needed > buffer.element_count()) {
+        grow(buffer, count, std::max(needed, buffer.element_count() * 2));
+    }
+
+    buffer.write(count * sizeof(T), data.data(), data.size() * sizeof(T));
+    count = needed;
+}
+
+// Appends added elements, to be written through the returned mapping. Lets streams derived from the mesh data
+// be written to the buffer directly, without an intermediate copy.
+template<typename T>
+static BufferMapping<T> append_mapped(TypedBuffer<T>& buffer, size_t& count, size_t added) {
+    const size_t needed = count + added;
+    if(needed > buffer.element_count()) {
+        grow(buffer, count, std::max(needed, buffer.element_count() * 2));
+    }
+
+    auto mapping = buffer.map_range(count, added);
+    count = needed;
+    return mapping;
+}
+
+static glm::vec2 sign_not_zero(const glm::vec2& v) {
+    return glm::vec2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+}
+
+static glm::i16vec2 encode_octahedral(const glm::vec3& v) {
+    const float l1 = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+    if(l1 <= 0.0f) {
+        return glm::i16vec2(0);
+    }
+
+    const glm::vec3 n = v / l1;
+    const glm::vec2 oct = n.z >= 0.0f ? glm::vec2(n) : (1.0f - glm::abs(glm::vec2(n.y, n.x))) * sign_not_zero(glm::vec2(n));
+    return glm::i16vec2(glm::round(glm::clamp(oct, -1.0f, 1.0f) * 32767.0f));
+}
+
+static CompactVertex compact_vertex(const Vertex& vertex, const glm::vec3& position_offset, const glm::vec3& inv_position_scale) {
+    const glm::vec3 position = glm::clamp((vertex.position - position_offset) * inv_position_scale, 0.0f, 1.0f);
+
+    CompactVertex compact = {};
+    compact.position = glm::u16vec4(glm::u16vec3(glm::round(position * 65535.0f)), vertex.tangent_bitangent_sign.w > 0.0f ? 65535 : 0);
+    compact.normal = encode_octahedral(vertex.normal);
+    compact.tangent = encode_octahedral(glm::vec3(vertex.tangent_bitangent_sign));
+    compact.uv = glm::u16vec2(glm::packHalf1x16(vertex.uv.x), glm::packHalf1x16(vertex.uv.y));
+    compact.color = glm::u8vec4(glm::round(glm::clamp(glm::vec4(vertex.color, 1.0f), 0.0f, 1.0f) * 255.0f));
+    return compact;
+}
+
+MeshArena::MeshArena(VertexFormat format) : _format(format) {
+}
+
+MeshRange MeshArena::add(const MeshView& data) {
+    MeshRange range;
+    range.first_index = u32(_index_count);
+    range.index_count = u32(data.indices.size());
+    range.base_vertex = u32(_vertex_count);
+    range.vertex_count = u32(data.vertices.size());
+
+    // Positions are duplicated in a tightly packed stream so depth only passes fetch only them
+    if(_format == VertexFormat::Compact) {
+        glm::vec3 min(std::numeric_limits<float>::max());
+        glm::vec3 max(-std::numeric_limits<float>::max());
+        for(const Vertex& vertex : data.vertices) {
+            min = glm::min(min, vertex.position);
+            max = glm::max(max, vertex.position);
+        }
+
+        range.position_offset = min;
+        range.position_scale = data.vertices.is_empty() ? glm::vec3(0.0f) : max - min;
+        const glm::vec3 inv_scale = glm::vec3(
+            range.position_scale.x > 0.0f ? 1.0f / range.position_scale.x : 0.0f,
+            range.position_scale.y > 0.0f ? 1.0f / range.position_scale.y : 0.0f,
+            range.position_scale.z > 0.0f ? 1.0f / range.position_scale.z : 0.0f
+        );
+
+        size_t position_count = _vertex_count;
+        auto positions = append_mapped(_compact_position_buffer, position_count, data.vertices.size());
+        auto vertices = append_mapped(_compact_vertex_buffer, _vertex_count, data.vertices.size());
+        for(size_t i = 0; i != data.vertices.size(); ++i) {
+            vertices[i] = compact_vertex(data.vertices[i], range.position_offset, inv_scale);
+            positions[i] = vertices[i].position;
+        }
+    } else {
+        size_t position_count = _vertex_count;
+        auto positions = append_mapped(_position_buffer, position_count, data.vertices.size());
+        for(size_t i = 0; i != data.vertices.size(); ++i) {
+            positions[i] = data.vertices[i].position;
+        }
+        append(_vertex_buffer, _vertex_count, data.vertices);
+    }
+    append(_index_buffer, _index_count, data.indices);
+
+    if(!data.meshlets.is_empty()) {
+        range.first_meshlet = u32(_meshlet_count);
+        range.meshlet_count = u32(data.meshlets.size());
+
+        // Meshlets index the arena's index buffer
+        auto meshlets = append_mapped(_meshlet_buffer, _meshlet_count, data.meshlets.size());
+        for(size_t i = 0; i != data.meshlets.size(); ++i) {
+            meshlets[i] = data.meshlets[i];
+            meshlets[i].first_index += range.first_index;
+        }
+    }
+
+    return range;
+}
+
+void MeshArena::reserve(size_t vertex_count, size_t index_count) {
+    if(_format == VertexFormat::Compact) {
+        if(vertex_count > _compact_vertex_buffer.element_count()) {
+            grow(_compact_vertex_buffer, _vertex_count, vertex_count);
+            grow(_compact_position_buffer, _vertex_count, vertex_count);
+        }
+    } else if(vertex_count > _vertex_buffer.element_count()) {
+        grow(_vertex_buffer, _vertex_count, vertex_count);
+        grow(_position_buffer, _vertex_count, vertex_count);
+    }
+    if(index_count > _index_buffer.element_count()) {
+        grow(_index_buffer, _index_count, index_count);
+    }
+}
+
+void MeshArena::bind() const {
+    if(_format == VertexFormat::Compact) {
+        _compact_vertex_buffer.bind_vertex_buffer(0, sizeof(CompactVertex));
+    } else {
+        _vertex_buffer.bind_vertex_buffer(0, sizeof(Vertex));
+    }
+    _index_buffer.bind(BufferUsage::Index);
+}
+
+void MeshArena::bind_positions() const {
+    if(_format == VertexFormat::Compact) {
+        _compact_position_buffer.bind_vertex_buffer(1, sizeof(glm::u16vec4));
+    } else {
+        _position_buffer.bind_vertex_buffer(1, sizeof(glm::vec3));
+    }
+    _index_buffer.bind(BufferUsage::Index);
+}
+
+void MeshArena::bind_meshlets(u32 meshlet_binding, u32 index_binding) const {
+    _meshlet_buffer.bind(BufferUsage::Storage, meshlet_binding);
+    _index_buffer.bind(BufferUsage::Storage, index_binding);
+}
+
+VertexFormat MeshArena::vertex_format() const {
+    return _format;
+}
+
+size_t MeshArena::vertex_count() const {
+    return _vertex_count;
+}
+
+size_t MeshArena::index_count() const {
+    return _index_count;
+}
+
+size_t MeshArena::byte_size() const {
+    const size_t vertex_bytes = _format == VertexFormat::Compact
+        ? sizeof(CompactVertex) + sizeof(glm::u16vec4)
+        : sizeof(Vertex) + sizeof(glm::vec3);
+    return _vertex_count * vertex_bytes + _index_count * sizeof(u32) + _meshlet_count * sizeof(shader::Meshlet);
+}
+
+}
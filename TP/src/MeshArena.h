@@ -0,0 +1,105 @@
+#ifndef MESHARENA_H
+#define MESHARENA_H
+
+#include <graphics.h>
+#include <shader_structs.h>
+#include <TypedBuffer.h>
+#include <Vertex.h>
+
+#include <vector>
+
+namespace OM3D {
+
+// Must match max_mesh_lods in structs.glsl
+static constexpr u32 max_mesh_lods = 4;
+
+// Simplified version of a mesh, indexing the same vertices
+struct MeshLod {
+    u32 index_count = 0;
+    // Simplification error, relative to the bounding radius of the mesh
+    float error = 0.0f;
+};
+
+struct MeshData {
+    std::vector<Vertex> vertices;
+    // Indices of every LOD, from the finest, one after the other
+    std::vector<u32> indices;
+    // Empty for meshes without LODs, otherwise lods[0] is the full detail mesh
+    std::vector<MeshLod> lods;
+    // Clusters of the full detail mesh, each covering a contiguous range of its indices. Empty for small meshes.
+    std::vector<shader::Meshlet> meshlets;
+};
+
+// Geometry that lives elsewhere, in a MeshData or a mapped file
+struct MeshView {
+    Span<const Vertex> vertices;
+    Span<const u32> indices;
+    Span<const MeshLod> lods;
+    Span<const shader::Meshlet> meshlets;
+
+    MeshView() = default;
+    MeshView(const MeshData& data) : vertices(data.vertices), indices(data.indices), lods(data.lods), meshlets(data.meshlets) {}
+    MeshView(Span<const Vertex> v, Span<const u32> i, Span<const MeshLod> l = {}, Span<const shader::Meshlet> m = {}) : vertices(v), indices(i), lods(l), meshlets(m) {}
+};
+
+// Location of a mesh inside an arena
+struct MeshRange {
+    u32 first_index = 0;
+    u32 index_count = 0;
+    u32 base_vertex = 0;
+    u32 vertex_count = 0;
+
+    // Meshlets in the arena's meshlet buffer, their first_index is relative to the arena's index buffer
+    u32 first_meshlet = 0;
+    u32 meshlet_count = 0;
+
+    // Compact positions decode to position_offset + position * position_scale
+    glm::vec3 position_offset = glm::vec3(0.0f);
+    glm::vec3 position_scale = glm::vec3(1.0f);
+};
+
+// Suballocates the geometry of many meshes inside a single vertex buffer and a single index buffer,
+// so that switching meshes needs no rebinding and draws can be batched with multi-draw indirect.
+// Buffers grow geometrically, copying their content on the GPU.
+// Compact arenas convert vertices to CompactVertex on upload.
+class MeshArena : NonMovable {
+
+    public:
+        MeshArena(VertexFormat format = VertexFormat::Standard);
+
+        MeshRange add(const MeshView& data);
+
+        // Grows the buffers so they can hold at least this many vertices and indices without reallocating
+        void reserve(size_t vertex_count, size_t index_count);
+
+        // Binds the vertex buffer (at binding 0) and the index buffer
+        void bind() const;
+        // Binds the position only vertex stream (at binding 1) and the index buffer, for depth only passes
+        void bind_positions() const;
+        // Binds the meshlets and the index buffer as storage buffers, for meshlet culling
+        void bind_meshlets(u32 meshlet_binding, u32 index_binding) const;
+
+        VertexFormat vertex_format() const;
+        size_t vertex_count() const;
+        size_t index_count() const;
+        // GPU memory used by vertices and indices
+        size_t byte_size() const;
+
+    private:
+        VertexFormat _format = VertexFormat::Standard;
+
+        TypedBuffer<Vertex> _vertex_buffer;
+        TypedBuffer<glm::vec3> _position_buffer;
+        TypedBuffer<CompactVertex> _compact_vertex_buffer;
+        TypedBuffer<glm::u16vec4> _compact_position_buffer;
+        TypedBuffer<u32> _index_buffer;
+        TypedBuffer<shader::Meshlet> _meshlet_buffer;
+
+        size_t _vertex_count = 0;
+        size_t _index_count = 0;
+        size_t _meshlet_count = 0;
+};
+
+}
+
+#endif // MESHARENA_H
@@ -0,0 +1,970 @@
+#include "MeshOptimizer.h"
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <tuple>
+#include <unordered_map>
+
+namespace OM3D {
+
+static constexpr u32 invalid_index = u32(-1);
+
+VertexCacheStats analyze_vertex_cache(Span<const u32> indices, size_t vertex_count, u32 cache_size) {
+    VertexCacheStats stats;
+    stats.triangle_count = indices.size() / 3;
+    stats.vertex_count = vertex_count;
+
+    // A vertex is in the cache if fewer than cache_size vertices were transformed since it was
+    std::vector<size_t> cache_time(vertex_count, 0);
+    size_t time = cache_size + 1;
+    for(const u32 index : indices) {
+        if(time - cache_time[index] > cache_size) {
+            cache_time[index] = time++;
+            ++stats.transformed_vertices;
+        }
+    }
+
+    return stats;
+}
+
+void weld_vertices(MeshData& mesh) {
+    struct VertexHasher {
+        size_t operator()(const Vertex* v) const {
+            u64 hash = 0xcbf29ce484222325;
+            const u8* bytes = reinterpret_cast<const u8*>(v);
+            for(size_t i = 0; i != sizeof(Vertex); ++i) {
+                hash = (hash ^ bytes[i]) * 0x100000001b3;
+            }
+            return size_t(hash);
+        }
+    };
+
+    struct VertexEqual {
+        bool operator()(const Vertex* a, const Vertex* b) const {
+            return std::memcmp(a, b, sizeof(Vertex)) == 0;
+        }
+    };
+
+    static_assert(sizeof(Vertex) == 15 * sizeof(float), "Vertex has padding, comparing bytes is not safe");
+
+    // Vertices keep the order of their first occurrence
+    std::unordered_map<const Vertex*, u32, VertexHasher, VertexEqual> unique;
+    unique.reserve(mesh.vertices.size());
+
+    std::vector<u32> remap(mesh.vertices.size());
+    std::vector<Vertex> vertices;
+    vertices.reserve(mesh.vertices.size());
+    for(size_t i = 0; i != mesh.vertices.size(); ++i) {
+        const auto [it, inserted] = unique.try_emplace(&mesh.vertices[i], u32(vertices.size()));
+        if(inserted) {
+            vertices.push_back(mesh.vertices[i]);
+        }
+        remap[i] = it->second;
+    }
+
+    for(u32& index : mesh.indices) {
+        index = remap[index];
+    }
+    mesh.vertices = std::move(vertices);
+}
+
+static void optimize_triangle_order(Span<const Vertex> vertices, std::vector<u32>& mesh_indices, bool optimize_overdraw, u32 cache_size) {
+    const size_t vertex_count = vertices.size();
+    const size_t triangle_count = mesh_indices.size() / 3;
+    if(!triangle_count) {
+        return;
+    }
+
+    // Triangles using each vertex, in compressed rows
+    std::vector<u32> live_triangles(vertex_count, 0);
+    for(size_t i = 0; i != triangle_count * 3; ++i) {
+        ++live_triangles[mesh_indices[i]];
+    }
+
+    std::vector<u32> adjacency_offsets(vertex_count + 1, 0);
+    std::partial_sum(live_triangles.begin(), live_triangles.end(), adjacency_offsets.begin() + 1);
+
+    std::vector<u32> adjacency(triangle_count * 3);
+    {
+        std::vector<u32> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+        for(size_t i = 0; i != triangle_count * 3; ++i) {
+            adjacency[fill[mesh_indices[i]]++] = u32(i / 3);
+        }
+    }
+
+    std::vector<size_t> cache_time(vertex_count, 0);
+    std::vector<bool> emitted(triangle_count, false);
+    std::vector<u32> dead_end_stack;
+    std::vector<u32> candidates;
+
+    std::vector<u32> triangle_order;
+    triangle_order.reserve(triangle_count);
+    // Index in triangle_order where each cluster starts
+    std::vector<u32> cluster_starts;
+
+    size_t time = cache_size + 1;
+    u32 cursor = 0;
+
+    auto skip_dead_end = [&]() -> u32 {
+        while(!dead_end_stack.empty()) {
+            const u32 vertex = dead_end_stack.back();
+            dead_end_stack.pop_back();
+            if(live_triangles[vertex]) {
+                return vertex;
+            }
+        }
+        for(; cursor != vertex_count; ++cursor) {
+            if(live_triangles[cursor]) {
+                return cursor;
+            }
+        }
+        return invalid_index;
+    };
+
+    u32 fanning = skip_dead_end();
+    cluster_starts.push_back(0);
+
+    while(fanning != invalid_index) {
+        candidates.clear();
+
+        for(u32 i = adjacency_offsets[fanning]; i != adjacency_offsets[fanning + 1]; ++i) {
+            const u32 triangle = adjacency[i];
+            if(emitted[triangle]) {
+                continue;
+            }
+
+            for(u32 k = 0; k != 3; ++k) {
+                const u32 vertex = mesh_indices[triangle * 3 + k];
+                dead_end_stack.push_back(vertex);
+                candidates.push_back(vertex);
+                --live_triangles[vertex];
+                if(time - cache_time[vertex] > cache_size) {
+                    cache_time[vertex] = time++;
+                }
+            }
+
+            emitted[triangle] = true;
+            triangle_order.push_back(triangle);
+        }
+
+        // Next fanning vertex: the one still in the cache that stays there longest once its triangles are emitted
+        u32 best = invalid_index;
+        i64 best_priority = -1;
+        for(const u32 vertex : candidates) {
+            if(!live_triangles[vertex]) {
+                continue;
+            }
+
+            i64 priority = 0;
+            if(time - cache_time[vertex] + 2 * live_triangles[vertex] <= cache_size) {
+                priority = i64(time - cache_time[vertex]);
+            }
+            if(priority > best_priority) {
+                best_priority = priority;
+                best = vertex;
+            }
+        }
+
+        if(best == invalid_index) {
+            best = skip_dead_end();
+            if(best != invalid_index && triangle_order.size() != triangle_count) {
+                cluster_starts.push_back(u32(triangle_order.size()));
+            }
+        }
+
+        fanning = best;
+    }
+
+    DEBUG_ASSERT(triangle_order.size() == triangle_count);
+
+    if(optimize_overdraw && cluster_starts.size() > 1) {
+        const size_t cluster_count = cluster_starts.size();
+        cluster_starts.push_back(u32(triangle_count));
+
+        auto triangle_vertex = [&](u32 triangle, u32 k) {
+            return vertices[mesh_indices[triangle * 3 + k]].position;
+        };
+
+        glm::vec3 mesh_center(0.0f);
+        for(const Vertex& vertex : vertices) {
+            mesh_center += vertex.position;
+        }
+        mesh_center /= float(vertex_count);
+
+        // Clusters on the outside, facing away from the center, are likely to occlude the others
+        std::vector<float> sort_keys(cluster_count);
+        for(size_t cluster = 0; cluster != cluster_count; ++cluster) {
+            glm::vec3 center(0.0f);
+            glm::vec3 normal(0.0f);
+            float area = 0.0f;
+            for(u32 i = cluster_starts[cluster]; i != cluster_starts[cluster + 1]; ++i) {
+                const u32 triangle = triangle_order[i];
+                const glm::vec3 a = triangle_vertex(triangle, 0);
+                const glm::vec3 b = triangle_vertex(triangle, 1);
+                const glm::vec3 c = triangle_vertex(triangle, 2);
+                const glm::vec3 n = glm::cross(b - a, c - a);
+                const float triangle_area = glm::length(n);
+                center += (a + b + c) * (triangle_area / 3.0f);
+                normal += n;
+                area += triangle_area;
+            }
+
+            if(area > 0.0f) {
+                center /= area;
+                const float normal_length = glm::length(normal);
+                sort_keys[cluster] = normal_length > 0.0f ? glm::dot(center - mesh_center, normal / normal_length) : 0.0f;
+            }
+        }
+
+        std::vector<u32> cluster_order(cluster_count);
+        std::iota(cluster_order.begin(), cluster_order.end(), 0u);
+        std::stable_sort(cluster_order.begin(), cluster_order.end(), [&](u32 a, u32 b) {
+            return sort_keys[a] > sort_keys[b];
+        });
+
+        std::vector<u32> sorted_triangles;
+        sorted_triangles.reserve(triangle_count);
+        for(const u32 c : cluster_order) {
+            sorted_triangles.insert(sorted_triangles.end(), triangle_order.begin() + cluster_starts[c], triangle_order.begin() + cluster_starts[c + 1]);
+        }
+        triangle_order = std::move(sorted_triangles);
+    }
+
+    std::vector<u32> indices;
+    indices.reserve(triangle_count * 3);
+    for(const u32 triangle : triangle_order) {
+        indices.insert(indices.end(), mesh_indices.begin() + triangle * 3, mesh_indices.begin() + triangle * 3 + 3);
+    }
+    mesh_indices = std::move(indices);
+}
+
+void optimize_vertex_cache(MeshData& mesh, bool optimize_overdraw, u32 cache_size) {
+    optimize_triangle_order(mesh.vertices, mesh.indices, optimize_overdraw, cache_size);
+}
+
+void optimize_vertex_fetch(MeshData& mesh) {
+    std::vector<u32> remap(mesh.vertices.size(), invalid_index);
+    std::vector<Vertex> vertices;
+    vertices.reserve(mesh.vertices.size());
+
+    for(u32& index : mesh.indices) {
+        if(remap[index] == invalid_index) {
+            remap[index] = u32(vertices.size());
+            vertices.push_back(mesh.vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    mesh.vertices = std::move(vertices);
+}
+
+void build_meshlets(MeshData& mesh) {
+    DEBUG_ASSERT(mesh.lods.empty());
+
+    const size_t vertex_count = mesh.vertices.size();
+    const size_t triangle_count = mesh.indices.size() / 3;
+    mesh.meshlets.clear();
+    if(triangle_count < min_meshlet_mesh_triangles) {
+        return;
+    }
+
+    std::vector<glm::vec3> centroids(triangle_count);
+    std::vector<glm::vec3> normals(triangle_count);
+    for(size_t t = 0; t != triangle_count; ++t) {
+        const glm::vec3& a = mesh.vertices[mesh.indices[t * 3]].position;
+        const glm::vec3& b = mesh.vertices[mesh.indices[t * 3 + 1]].position;
+        const glm::vec3& c = mesh.vertices[mesh.indices[t * 3 + 2]].position;
+        const glm::vec3 n = glm::cross(b - a, c - a);
+        const float length = glm::length(n);
+        centroids[t] = (a + b + c) / 3.0f;
+        normals[t] = length > 0.0f ? n / length : glm::vec3(0.0f);
+    }
+
+    // Triangles using each vertex, in compressed rows
+    std::vector<u32> adjacency_offsets(vertex_count + 1, 0);
+    for(const u32 index : mesh.indices) {
+        ++adjacency_offsets[index + 1];
+    }
+    std::partial_sum(adjacency_offsets.begin(), adjacency_offsets.end(), adjacency_offsets.begin());
+
+    std::vector<u32> adjacency(triangle_count * 3);
+    {
+        std::vector<u32> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+        for(size_t i = 0; i != triangle_count * 3; ++i) {
+            adjacency[fill[mesh.indices[i]]++] = u32(i / 3);
+        }
+    }
+
+    std::vector<bool> emitted(triangle_count, false);
+    // Meshlet each vertex was last added to, so membership is checked without clearing anything
+    std::vector<u32> vertex_meshlet(vertex_count, invalid_index);
+
+    std::vector<u32> indices;
+    indices.reserve(mesh.indices.size());
+    std::vector<u32> triangles;
+    std::vector<u32> vertices;
+    size_t cursor = 0;
+
+    auto new_vertex_count = [&](u32 triangle, u32 meshlet) {
+        u32 count = 0;
+        for(u32 k = 0; k != 3; ++k) {
+            count += vertex_meshlet[mesh.indices[triangle * 3 + k]] != meshlet;
+        }
+        return count;
+    };
+
+    while(true) {
+        while(cursor != triangle_count && emitted[cursor]) {
+            ++cursor;
+        }
+        if(cursor == triangle_count) {
+            break;
+        }
+
+        const u32 meshlet = u32(mesh.meshlets.size());
+        triangles.clear();
+        vertices.clear();
+        glm::vec3 centroid_sum(0.0f);
+        glm::vec3 normal_sum(0.0f);
+
+        auto add_triangle = [&](u32 triangle) {
+            for(u32 k = 0; k != 3; ++k) {
+                const u32 vertex = mesh.indices[triangle * 3 + k];
+                if(vertex_meshlet[vertex] != meshlet) {
+                    vertex_meshlet[vertex] = meshlet;
+                    vertices.push_back(vertex);
+                }
+            }
+            emitted[triangle] = true;
+            triangles.push_back(triangle);
+            centroid_sum += centroids[triangle];
+            normal_sum += normals[triangle];
+        };
+
+        add_triangle(u32(cursor));
+
+        // Grow around the meshlet: first with triangles adding the fewest vertices, then with the closest ones facing the same way
+        while(triangles.size() != max_meshlet_triangles) {
+            const glm::vec3 centroid = centroid_sum / float(triangles.size());
+            const glm::vec3 normal = glm::length(normal_sum) > 0.0f ? glm::normalize(normal_sum) : glm::vec3(0.0f);
+
+            u32 best = invalid_index;
+            u32 best_new_vertices = 4;
+            float best_score = std::numeric_limits<float>::max();
+            auto consider = [&](u32 triangle) {
+                if(emitted[triangle]) {
+                    return;
+                }
+
+                const u32 new_vertices = new_vertex_count(triangle, meshlet);
+                if(vertices.size() + new_vertices > max_meshlet_vertices) {
+                    return;
+                }
+
+                const glm::vec3 offset = centroids[triangle] - centroid;
+                const float score = glm::dot(offset, offset) * (2.0f - glm::dot(normals[triangle], normal));
+                if(std::tie(new_vertices, score, triangle) < std::tie(best_new_vertices, best_score, best)) {
+                    best = triangle;
+                    best_new_vertices = new_vertices;
+                    best_score = score;
+                }
+            };
+
+            for(const u32 vertex : vertices) {
+                for(u32 i = adjacency_offsets[vertex]; i != adjacency_offsets[vertex + 1]; ++i) {
+                    consider(adjacency[i]);
+                }
+            }
+
+            // Disconnected pieces: look for the closest one among the next triangles in cache order
+            if(best == invalid_index) {
+                size_t scanned = 0;
+                for(size_t t = cursor; t != triangle_count && scanned != meshlet_search_window; ++t) {
+                    if(!emitted[t]) {
+                        consider(u32(t));
+                        ++scanned;
+                    }
+                }
+            }
+
+            if(best == invalid_index) {
+                break;
+            }
+            add_triangle(best);
+        }
+
+        // Keep the vertex cache order inside the meshlet
+        std::sort(triangles.begin(), triangles.end());
+
+        shader::Meshlet bounds = {};
+        bounds.first_index = u32(indices.size());
+        bounds.triangle_count = u32(triangles.size());
+
+        glm::vec3 min(std::numeric_limits<float>::max());
+        glm::vec3 max(-std::numeric_limits<float>::max());
+        for(const u32 vertex : vertices) {
+            min = glm::min(min, mesh.vertices[vertex].position);
+            max = glm::max(max, mesh.vertices[vertex].position);
+        }
+        bounds.center = (min + max) * 0.5f;
+        for(const u32 vertex : vertices) {
+            bounds.radius = std::max(bounds.radius, glm::length(mesh.vertices[vertex].position - bounds.center));
+        }
+
+        // Normal cone, see shader::Meshlet. Cones wider than a half space can never be culled.
+        bounds.cone_cutoff = 1.0f;
+        if(glm::length(normal_sum) > 0.0f) {
+            const glm::vec3 axis = glm::normalize(normal_sum);
+            float min_dot = 1.0f;
+            for(const u32 triangle : triangles) {
+                if(normals[triangle] != glm::vec3(0.0f)) {
+                    min_dot = std::min(min_dot, glm::dot(normals[triangle], axis));
+                }
+            }
+            bounds.cone_axis = axis;
+            bounds.cone_cutoff = min_dot <= 0.1f ? 1.0f : std::sqrt(1.0f - min_dot * min_dot);
+        }
+
+        for(const u32 triangle : triangles) {
+            indices.insert(indices.end(), mesh.indices.begin() + triangle * 3, mesh.indices.begin() + triangle * 3 + 3);
+        }
+        mesh.meshlets.push_back(bounds);
+    }
+
+    mesh.indices = std::move(indices);
+}
+
+// Sum of the squared distances to a set of weighted planes
+struct Quadric {
+    float a00 = 0.0f;
+    float a11 = 0.0f;
+    float a22 = 0.0f;
+    float a10 = 0.0f;
+    float a20 = 0.0f;
+    float a21 = 0.0f;
+    float b0 = 0.0f;
+    float b1 = 0.0f;
+    float b2 = 0.0f;
+    float c = 0.0f;
+    float weight = 0.0f;
+
+    // Plane of points p such that dot(normal, p) + offset = 0
+    void add_plane(const glm::vec3& normal, float offset, float w) {
+        a00 += w * normal.x * normal.x;
+        a11 += w * normal.y * normal.y;
+        a22 += w * normal.z * normal.z;
+        a10 += w * normal.y * normal.x;
+        a20 += w * normal.z * normal.x;
+        a21 += w * normal.z * normal.y;
+        b0 += w * normal.x * offset;
+        b1 += w * normal.y * offset;
+        b2 += w * normal.z * offset;
+        c += w * offset * offset;
+        weight += w;
+    }
+
+    void add(const Quadric& other) {
+        a00 += other.a00;
+        a11 += other.a11;
+        a22 += other.a22;
+        a10 += other.a10;
+        a20 += other.a20;
+        a21 += other.a21;
+        b0 += other.b0;
+        b1 += other.b1;
+        b2 += other.b2;
+        c += other.c;
+        weight += other.weight;
+    }
+
+    // Weighted mean of the squared distances from p to the planes
+    float error(const glm::vec3& p) const {
+        const float rx = a00 * p.x + a10 * p.y + a20 * p.z;
+        const float ry = a10 * p.x + a11 * p.y + a21 * p.z;
+        const float rz = a20 * p.x + a21 * p.y + a22 * p.z;
+        const float r = rx * p.x + ry * p.y + rz * p.z + 2.0f * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+        return weight > 0.0f ? std::abs(r) / weight : 0.0f;
+    }
+};
+
+enum class SimplifyVertexKind : u8 {
+    // Surrounded by triangles, with a single set of attributes
+    Manifold,
+    // On a simple open boundary: can only slide along it
+    Border,
+    // On a simple attribute seam, with two sets of attributes: can only slide along the seam
+    Seam,
+    Locked,
+};
+
+// Border edges are weighted more than triangles, so the silhouette of open meshes is kept
+static constexpr float border_weight = 10.0f;
+
+std::vector<u32> simplify(Span<const Vertex> vertices, Span<const u32> source_indices, size_t target_index_count, float target_error, float* result_error) {
+    std::vector<u32> indices(source_indices.begin(), source_indices.end());
+    const size_t vertex_count = vertices.size();
+
+    if(result_error) {
+        *result_error = 0.0f;
+    }
+    if(indices.size() <= target_index_count) {
+        return indices;
+    }
+
+    // Work in a unit box, so errors don't depend on the mesh size
+    glm::vec3 min(std::numeric_limits<float>::max());
+    glm::vec3 max(-std::numeric_limits<float>::max());
+    for(const u32 index : indices) {
+        min = glm::min(min, vertices[index].position);
+        max = glm::max(max, vertices[index].position);
+    }
+    const float extent = std::max(max.x - min.x, std::max(max.y - min.y, max.z - min.z));
+    const float scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+
+    std::vector<glm::vec3> positions(vertex_count);
+    for(size_t i = 0; i != vertex_count; ++i) {
+        positions[i] = (vertices[i].position - min) * scale;
+    }
+
+    // Vertices sharing a position (with different attributes) move together: topology is tracked by position,
+    // using the first vertex with each position to identify it
+    std::vector<u32> position_ids(vertex_count);
+    {
+        struct PositionHasher {
+            size_t operator()(const glm::vec3* p) const {
+                u32 bits[3] = {};
+                std::memcpy(bits, p, sizeof(bits));
+                return size_t((u64(bits[0]) * 73856093) ^ (u64(bits[1]) * 19349663) ^ (u64(bits[2]) * 83492791));
+            }
+        };
+
+        struct PositionEqual {
+            bool operator()(const glm::vec3* a, const glm::vec3* b) const {
+                return std::memcmp(a, b, sizeof(glm::vec3)) == 0;
+            }
+        };
+
+        std::unordered_map<const glm::vec3*, u32, PositionHasher, PositionEqual> unique;
+        unique.reserve(vertex_count);
+        for(size_t i = 0; i != vertex_count; ++i) {
+            position_ids[i] = unique.try_emplace(&vertices[i].position, u32(i)).first->second;
+        }
+    }
+
+    auto position_id = [&](u32 index) {
+        return position_ids[index];
+    };
+
+    // Triangles around each position, rebuilt after every pass
+    std::vector<u32> adjacency_offsets(vertex_count + 1);
+    std::vector<u32> adjacency;
+    auto build_adjacency = [&] {
+        std::fill(adjacency_offsets.begin(), adjacency_offsets.end(), 0);
+        for(const u32 index : indices) {
+            ++adjacency_offsets[position_id(index) + 1];
+        }
+        std::partial_sum(adjacency_offsets.begin(), adjacency_offsets.end(), adjacency_offsets.begin());
+
+        adjacency.resize(indices.size());
+        std::vector<u32> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+        for(size_t i = 0; i != indices.size(); ++i) {
+            adjacency[fill[position_id(indices[i])]++] = u32(i / 3);
+        }
+    };
+
+    // Calls f(triangle) for every triangle using position p
+    auto for_each_triangle = [&](u32 p, auto&& f) {
+        for(u32 i = adjacency_offsets[p]; i != adjacency_offsets[p + 1]; ++i) {
+            f(adjacency[i]);
+        }
+    };
+
+    // Some triangle around position p has the edge from a to b, as positions or as vertices
+    auto has_position_edge = [&](u32 p, u32 a, u32 b) {
+        for(u32 i = adjacency_offsets[p]; i != adjacency_offsets[p + 1]; ++i) {
+            const u32 t = adjacency[i] * 3;
+            for(u32 k = 0; k != 3; ++k) {
+                if(position_id(indices[t + k]) == a && position_id(indices[t + (k + 1) % 3]) == b) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    };
+    auto has_vertex_edge = [&](u32 p, u32 a, u32 b) {
+        for(u32 i = adjacency_offsets[p]; i != adjacency_offsets[p + 1]; ++i) {
+            const u32 t = adjacency[i] * 3;
+            for(u32 k = 0; k != 3; ++k) {
+                if(indices[t + k] == a && indices[t + (k + 1) % 3] == b) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    };
+
+    build_adjacency();
+
+    // Quadrics of the original triangles, accumulated as positions collapse onto each other
+    std::vector<Quadric> quadrics(vertex_count);
+    for(size_t t = 0; t != indices.size(); t += 3) {
+        const u32 p[] = {position_id(indices[t]), position_id(indices[t + 1]), position_id(indices[t + 2])};
+        const glm::vec3 cross = glm::cross(positions[p[1]] - positions[p[0]], positions[p[2]] - positions[p[0]]);
+        const float length = glm::length(cross);
+        if(length <= 0.0f) {
+            continue;
+        }
+
+        const glm::vec3 normal = cross / length;
+        for(u32 k = 0; k != 3; ++k) {
+            quadrics[p[k]].add_plane(normal, -glm::dot(normal, positions[p[0]]), length * 0.5f);
+        }
+
+        // Plane through border edges, perpendicular to their triangle
+        for(u32 k = 0; k != 3; ++k) {
+            const u32 a = p[k];
+            const u32 b = p[(k + 1) % 3];
+            if(has_position_edge(a, b, a)) {
+                continue;
+            }
+
+            const glm::vec3 edge = positions[b] - positions[a];
+            const float edge_length = glm::length(edge);
+            if(edge_length <= 0.0f) {
+                continue;
+            }
+
+            const glm::vec3 border_normal = glm::normalize(glm::cross(edge, normal));
+            const float offset = -glm::dot(border_normal, positions[a]);
+            const float weight = edge_length * edge_length * border_weight;
+            quadrics[a].add_plane(border_normal, offset, weight);
+            quadrics[b].add_plane(border_normal, offset, weight);
+        }
+    }
+
+    struct Collapse {
+        float cost;
+        u32 from;
+        u32 to;
+
+        bool operator<(const Collapse& other) const {
+            return std::tie(cost, from, to) < std::tie(other.cost, other.from, other.to);
+        }
+    };
+
+    const float error_limit = target_error * scale * target_error * scale;
+    float max_error = 0.0f;
+
+    std::vector<SimplifyVertexKind> kinds(vertex_count);
+    std::vector<Collapse> collapses;
+    std::vector<u32> remap(vertex_count);
+    std::vector<bool> locked(vertex_count);
+    std::vector<u32> from_neighbors;
+    std::vector<u32> to_neighbors;
+    std::vector<std::pair<u32, u32>> wedge_remap;
+
+    while(indices.size() > target_index_count) {
+        // Classify positions from the triangles around them
+        for(u32 p = 0; p != vertex_count; ++p) {
+            if(position_id(p) != p || adjacency_offsets[p] == adjacency_offsets[p + 1]) {
+                kinds[p] = SimplifyVertexKind::Locked;
+                continue;
+            }
+
+            u32 border_edges = 0;
+            u32 seam_edges = 0;
+            u32 wedges[2] = {invalid_index, invalid_index};
+            bool complex = false;
+            for_each_triangle(p, [&](u32 triangle) {
+                const u32 t = triangle * 3;
+                for(u32 k = 0; k != 3; ++k) {
+                    const u32 vertex = indices[t + k];
+                    if(position_id(vertex) != p) {
+                        continue;
+                    }
+
+                    if(wedges[0] == invalid_index || wedges[0] == vertex) {
+                        wedges[0] = vertex;
+                    } else if(wedges[1] == invalid_index || wedges[1] == vertex) {
+                        wedges[1] = vertex;
+                    } else {
+                        complex = true;
+                    }
+
+                    // Edges leaving and entering p, checked for a matching edge in the opposite direction
+                    const std::pair<u32, u32> edges[] = {{vertex, indices[t + (k + 1) % 3]}, {indices[t + (k + 2) % 3], vertex}};
+                    for(const auto& [a, b] : edges) {
+                        if(!has_position_edge(p, position_id(b), position_id(a))) {
+                            ++border_edges;
+                        } else if(!has_vertex_edge(p, b, a)) {
+                            ++seam_edges;
+                        }
+                    }
+                }
+            });
+
+            const bool single_wedge = wedges[1] == invalid_index;
+            if(complex) {
+                kinds[p] = SimplifyVertexKind::Locked;
+            } else if(single_wedge && !border_edges && !seam_edges) {
+                kinds[p] = SimplifyVertexKind::Manifold;
+            } else if(single_wedge && border_edges == 2 && !seam_edges) {
+                kinds[p] = SimplifyVertexKind::Border;
+            } else if(!single_wedge && !border_edges && seam_edges == 4) {
+                kinds[p] = SimplifyVertexKind::Seam;
+            } else {
+                kinds[p] = SimplifyVertexKind::Locked;
+            }
+        }
+
+        // Every edge, in its cheapest direction. Border vertices can only move along borders, seam vertices along seams.
+        collapses.clear();
+        for(size_t t = 0; t != indices.size(); t += 3) {
+            for(u32 k = 0; k != 3; ++k) {
+                const u32 va = indices[t + k];
+                const u32 vb = indices[t + (k + 1) % 3];
+                const u32 a = position_id(va);
+                const u32 b = position_id(vb);
+
+                const bool border = !has_position_edge(a, b, a);
+                // Inner edges are seen from both of their triangles
+                if(a == b || (a > b && !border)) {
+                    continue;
+                }
+                const bool seam = !border && !has_vertex_edge(a, vb, va);
+
+                auto can_move = [&](u32 p) {
+                    switch(kinds[p]) {
+                        case SimplifyVertexKind::Manifold:
+                            return true;
+                        case SimplifyVertexKind::Border:
+                            return border;
+                        case SimplifyVertexKind::Seam:
+                            return seam;
+                        default:
+                            return false;
+                    }
+                };
+
+                Collapse collapse = {std::numeric_limits<float>::max(), invalid_index, invalid_index};
+                if(can_move(a)) {
+                    collapse = {quadrics[a].error(positions[b]), a, b};
+                }
+                if(can_move(b)) {
+                    const float cost = quadrics[b].error(positions[a]);
+                    if(cost < collapse.cost) {
+                        collapse = {cost, b, a};
+                    }
+                }
+                if(collapse.from != invalid_index) {
+                    collapses.push_back(collapse);
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end());
+
+        std::iota(remap.begin(), remap.end(), 0u);
+        std::fill(locked.begin(), locked.end(), false);
+
+        // Positions whose triangles are changed by a collapse are locked until the next pass,
+        // so every collapse is checked against up to date triangles
+        auto lock_neighbors = [&](u32 p) {
+            for_each_triangle(p, [&](u32 triangle) {
+                for(u32 k = 0; k != 3; ++k) {
+                    locked[position_id(indices[triangle * 3 + k])] = true;
+                }
+            });
+        };
+
+        auto collect_neighbors = [&](u32 p, std::vector<u32>& neighbors) {
+            neighbors.clear();
+            for_each_triangle(p, [&](u32 triangle) {
+                for(u32 k = 0; k != 3; ++k) {
+                    const u32 q = position_id(indices[triangle * 3 + k]);
+                    if(q != p) {
+                        neighbors.push_back(q);
+                    }
+                }
+            });
+            std::sort(neighbors.begin(), neighbors.end());
+            neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+        };
+
+        const size_t triangle_goal = (indices.size() - target_index_count) / 3;
+        size_t removed_triangles = 0;
+
+        for(const Collapse& collapse : collapses) {
+            if(removed_triangles >= triangle_goal || collapse.cost > error_limit) {
+                break;
+            }
+
+            const u32 from = collapse.from;
+            const u32 to = collapse.to;
+            if(locked[from] || locked[to]) {
+                continue;
+            }
+
+            // Every vertex at the collapsed position must map to one vertex at the target position
+            wedge_remap.clear();
+            u32 shared_triangles = 0;
+            bool valid = true;
+            for_each_triangle(from, [&](u32 triangle) {
+                const u32 t = triangle * 3;
+                u32 from_vertex = invalid_index;
+                u32 to_vertex = invalid_index;
+                for(u32 k = 0; k != 3; ++k) {
+                    const u32 p = position_id(indices[t + k]);
+                    if(p == from) {
+                        from_vertex = indices[t + k];
+                    } else if(p == to) {
+                        to_vertex = indices[t + k];
+                    }
+                }
+
+                auto it = std::find_if(wedge_remap.begin(), wedge_remap.end(), [&](const auto& w) { return w.first == from_vertex; });
+                if(it == wedge_remap.end()) {
+                    it = wedge_remap.insert(wedge_remap.end(), {from_vertex, invalid_index});
+                }
+
+                if(to_vertex == invalid_index) {
+                    // Triangles that are not collapsed must not flip
+                    glm::vec3 corners[3];
+                    glm::vec3 moved[3];
+                    for(u32 k = 0; k != 3; ++k) {
+                        const u32 p = position_id(indices[t + k]);
+                        corners[k] = positions[p];
+                        moved[k] = positions[p == from ? to : p];
+                    }
+                    const glm::vec3 before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+                    const glm::vec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+                    valid = valid && glm::dot(before, after) > 0.0f;
+                    return;
+                }
+
+                ++shared_triangles;
+                valid = valid && (it->second == invalid_index || it->second == to_vertex);
+                it->second = to_vertex;
+            });
+
+            for(const auto& [from_vertex, to_vertex] : wedge_remap) {
+                valid = valid && to_vertex != invalid_index;
+            }
+            if(!valid) {
+                continue;
+            }
+
+            // Link condition: the only positions adjacent to both ends are those of the collapsed triangles,
+            // otherwise the collapse would pinch the surface
+            collect_neighbors(from, from_neighbors);
+            collect_neighbors(to, to_neighbors);
+            size_t common_neighbors = 0;
+            for(auto a = from_neighbors.begin(), b = to_neighbors.begin(); a != from_neighbors.end() && b != to_neighbors.end();) {
+                if(*a < *b) {
+                    ++a;
+                } else if(*b < *a) {
+                    ++b;
+                } else {
+                    ++common_neighbors;
+                    ++a;
+                    ++b;
+                }
+            }
+            if(common_neighbors != shared_triangles) {
+                continue;
+            }
+
+            for(const auto& [from_vertex, to_vertex] : wedge_remap) {
+                remap[from_vertex] = to_vertex;
+            }
+            quadrics[to].add(quadrics[from]);
+            lock_neighbors(from);
+            lock_neighbors(to);
+
+            max_error = std::max(max_error, collapse.cost);
+            removed_triangles += shared_triangles;
+        }
+
+        if(!removed_triangles) {
+            break;
+        }
+
+        // Drop the triangles that collapsed
+        size_t write = 0;
+        for(size_t t = 0; t != indices.size(); t += 3) {
+            const u32 a = remap[indices[t]];
+            const u32 b = remap[indices[t + 1]];
+            const u32 c = remap[indices[t + 2]];
+            if(position_id(a) != position_id(b) && position_id(b) != position_id(c) && position_id(c) != position_id(a)) {
+                indices[write++] = a;
+                indices[write++] = b;
+                indices[write++] = c;
+            }
+        }
+        indices.resize(write);
+
+        build_adjacency();
+    }
+
+    if(result_error) {
+        *result_error = std::sqrt(max_error) / scale;
+    }
+
+    return indices;
+}
+
+void generate_lods(MeshData& mesh, float max_error) {
+    DEBUG_ASSERT(mesh.lods.empty());
+
+    const size_t index_count = mesh.indices.size();
+    if(mesh.vertices.empty() || !index_count) {
+        return;
+    }
+
+    // Same bounding sphere as StaticMesh
+    glm::vec3 min(mesh.vertices[0].position);
+    glm::vec3 max(mesh.vertices[0].position);
+    for(const Vertex& vertex : mesh.vertices) {
+        min = glm::min(min, vertex.position);
+        max = glm::max(max, vertex.position);
+    }
+    const float radius = glm::length(max - min) * 0.5f;
+    if(radius <= 0.0f) {
+        return;
+    }
+
+    mesh.lods.push_back({u32(index_count), 0.0f});
+    for(u32 lod = 1; lod != max_mesh_lods; ++lod) {
+        // Every LOD is simplified from the full detail mesh, with half the triangles of the previous one
+        const size_t target_index_count = (index_count >> lod) / 3 * 3;
+        float error = 0.0f;
+        std::vector<u32> indices = simplify(mesh.vertices, Span<const u32>(mesh.indices.data(), index_count), target_index_count, max_error * radius, &error);
+
+        // Stop once simplification stalls: another LOD would barely save anything
+        const u32 previous_index_count = mesh.lods.back().index_count;
+        if(indices.empty() || indices.size() * 5 > previous_index_count * 4) {
+            break;
+        }
+
+        optimize_triangle_order(mesh.vertices, indices, true, vertex_cache_size);
+        mesh.lods.push_back({u32(indices.size()), std::max(error / radius, mesh.lods.back().error)});
+        mesh.indices.insert(mesh.indices.end(), indices.begin(), indices.end());
+    }
+
+    if(mesh.lods.size() == 1) {
+        mesh.lods.clear();
+    }
+}
+
+void optimize_mesh(MeshData& mesh, bool optimize_overdraw) {
+    weld_vertices(mesh);
+    optimize_vertex_cache(mesh, optimize_overdraw);
+    optimize_vertex_fetch(mesh);
+}
+
+}
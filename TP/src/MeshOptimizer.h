@@ -0,0 +1,70 @@
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+#include <MeshArena.h>
+
+namespace OM3D {
+
+// Post-transform vertex cache efficiency of an index buffer, simulated with a FIFO cache
+struct VertexCacheStats {
+    size_t transformed_vertices = 0;
+    size_t triangle_count = 0;
+    size_t vertex_count = 0;
+
+    // Average cache miss ratio: transformed vertices per triangle, 0.5 at best, 3 at worst
+    float acmr() const {
+        return triangle_count ? float(transformed_vertices) / float(triangle_count) : 0.0f;
+    }
+
+    // Average transform to vertex ratio: 1 means every vertex is transformed exactly once
+    float atvr() const {
+        return vertex_count ? float(transformed_vertices) / float(vertex_count) : 0.0f;
+    }
+
+    void add(const VertexCacheStats& other) {
+        transformed_vertices += other.transformed_vertices;
+        triangle_count += other.triangle_count;
+        vertex_count += other.vertex_count;
+    }
+};
+
+static constexpr u32 vertex_cache_size = 16;
+
+VertexCacheStats analyze_vertex_cache(Span<const u32> indices, size_t vertex_count, u32 cache_size = vertex_cache_size);
+
+// Merges bitwise identical vertices
+void weld_vertices(MeshData& mesh);
+
+// Reorders triangles for vertex cache locality using Tipsify [Sander et al. 2007].
+// With optimize_overdraw, the clusters Tipsify emits between dead ends are then sorted to draw outward facing ones first.
+void optimize_vertex_cache(MeshData& mesh, bool optimize_overdraw = false, u32 cache_size = vertex_cache_size);
+
+// Reorders vertices in the order the index buffer first uses them and drops unused ones
+void optimize_vertex_fetch(MeshData& mesh);
+
+// Runs every step above, in order. Deterministic: the same input always gives the same output.
+void optimize_mesh(MeshData& mesh, bool optimize_overdraw = true);
+
+static constexpr u32 max_meshlet_triangles = 124;
+static constexpr u32 max_meshlet_vertices = 64;
+// Smaller meshes are culled as a whole
+static constexpr u32 min_meshlet_mesh_triangles = 4 * max_meshlet_triangles;
+// Triangles searched for the closest one, when a meshlet can't grow with adjacent triangles
+static constexpr u32 meshlet_search_window = 256;
+
+// Splits meshes of at least min_meshlet_mesh_triangles triangles into meshlets of spatially close triangles with similar normals,
+// and reorders the indices so each one is contiguous. Run after optimize_mesh and before generate_lods.
+void build_meshlets(MeshData& mesh);
+
+// Simplifies a mesh with quadric error metrics [Garland and Heckbert 1997], collapsing edges onto one of their vertices
+// so the result indexes the same vertices. Open borders and attribute seams are preserved.
+// Stops at target_index_count, or before the error (a distance, in mesh units) would go over target_error.
+std::vector<u32> simplify(Span<const Vertex> vertices, Span<const u32> indices, size_t target_index_count, float target_error, float* result_error = nullptr);
+
+// Appends up to max_mesh_lods - 1 simplified versions of the mesh after its indices, halving the triangle count every time,
+// as long as their error stays under max_error times the bounding radius. Run after optimize_mesh.
+void generate_lods(MeshData& mesh, float max_error = 0.25f);
+
+}
+
+#endif // MESHOPTIMIZER_H
@@ -0,0 +1,91 @@
+#include "RingBuffer.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+
+namespace OM3D {
+
+static size_t slot_alignment() {
+    GLint uniform_alignment = 0;
+    GLint storage_alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniform_alignment);
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storage_alignment);
+    return size_t(std::max(std::max(uniform_alignment, storage_alignment), 16));
+}
+
+RingBufferBase::RingBufferBase(size_t slot_byte_size) :
+        _slot_byte_size(slot_byte_size),
+        _aligned_slot_byte_size(align_up_to(u32(slot_byte_size), u32(slot_alignment()))) {
+
+    _buffer = ByteBuffer(nullptr, _aligned_slot_byte_size * frame_count, BufferStorage::PersistentWrite);
+}
+
+RingBufferBase::RingBufferBase(RingBufferBase&& other) {
+    swap(other);
+}
+
+RingBufferBase& RingBufferBase::operator=(RingBufferBase&& other) {
+    swap(other);
+    return *this;
+}
+
+RingBufferBase::~RingBufferBase() {
+    for(void* fence : _fences) {
+        if(fence) {
+            glDeleteSync(static_cast<GLsync>(fence));
+        }
+    }
+}
+
+void RingBufferBase::swap(RingBufferBase& other) {
+    std::swap(_buffer, other._buffer);
+    std::swap(_slot_byte_size, other._slot_byte_size);
+    std::swap(_aligned_slot_byte_size, other._aligned_slot_byte_size);
+    std::swap(_slot, other._slot);
+    std::swap(_fences, other._fences);
+}
+
+void RingBufferBase::bind(BufferUsage usage, u32 index) const {
+    _buffer.bind(usage, index, slot_byte_offset(), _slot_byte_size);
+}
+
+void RingBufferBase::bind(BufferUsage usage) const {
+    _buffer.bind(usage);
+}
+
+size_t RingBufferBase::slot_byte_offset() const {
+    return _slot * _aligned_slot_byte_size;
+}
+
+bool RingBufferBase::is_null() const {
+    return !_slot_byte_size;
+}
+
+size_t RingBufferBase::slot_byte_size() const {
+    return _slot_byte_size;
+}
+
+void* RingBufferBase::next_slot() {
+    DEBUG_ASSERT(!is_null());
+
+    // Every command using the current slot has been submitted
+    if(_fences[_slot]) {
+        glDeleteSync(static_cast<GLsync>(_fences[_slot]));
+    }
+    _fences[_slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    _slot = (_slot + 1) % frame_count;
+
+    if(const GLsync fence = static_cast<GLsync>(_fences[_slot])) {
+        constexpr GLuint64 timeout = 1000000000; // 1s
+        while(glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout) == GL_TIMEOUT_EXPIRED) {
+        }
+        glDeleteSync(fence);
+        _fences[_slot] = nullptr;
+    }
+
+    return static_cast<byte*>(_buffer.persistent_mapping()) + slot_byte_offset();
+}
+
+}
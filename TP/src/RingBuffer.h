@@ -0,0 +1,71 @@
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <ByteBuffer.h>
+
+#include <array>
+
+namespace OM3D {
+
+// Persistently mapped buffer split into frame_count slots.
+// Every call to map_next() moves to the next slot, waiting for the GPU to be done with it first,
+// so data can be rewritten every frame without creating or orphaning GL buffers.
+class RingBufferBase : NonCopyable {
+
+    public:
+        static constexpr u32 frame_count = 3;
+
+        RingBufferBase() = default;
+        RingBufferBase(RingBufferBase&& other);
+        RingBufferBase& operator=(RingBufferBase&& other);
+
+        ~RingBufferBase();
+
+        // Binds the slot written by the last call to map_next()
+        void bind(BufferUsage usage, u32 index) const;
+
+        // Binds the whole buffer, the current slot starts at slot_byte_offset()
+        void bind(BufferUsage usage) const;
+        size_t slot_byte_offset() const;
+
+        bool is_null() const;
+
+    protected:
+        RingBufferBase(size_t slot_byte_size);
+
+        void* next_slot();
+        size_t slot_byte_size() const;
+
+    private:
+        void swap(RingBufferBase& other);
+
+        ByteBuffer _buffer;
+        size_t _slot_byte_size = 0;
+        size_t _aligned_slot_byte_size = 0;
+        u32 _slot = 0;
+
+        // GLsync objects, one per slot
+        std::array<void*, frame_count> _fences = {};
+};
+
+template<typename T>
+class RingBuffer : public RingBufferBase {
+    public:
+        RingBuffer() = default;
+
+        RingBuffer(size_t count) : RingBufferBase(count * sizeof(T)) {
+        }
+
+        size_t element_count() const {
+            return slot_byte_size() / sizeof(T);
+        }
+
+        BufferMapping<T> map_next() {
+            // Persistent mappings are never unmapped, so the returned mapping doesn't own the buffer handle
+            return BufferMapping<T>(next_slot(), slot_byte_size(), GLHandle());
+        }
+};
+
+}
+
+#endif // RINGBUFFER_H
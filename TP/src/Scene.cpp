@@ -1,18 +1,65 @@
 #include "Scene.h"
 
-#include <TypedBuffer.h>
+#include <StateCache.h>
 
 #include <shader_structs.h>
 
+#include <glad/glad.h>
+
+#include <glm/packing.hpp>
+
 #include <algorithm>
+#include <limits>
 #include <unordered_map>
 
 namespace OM3D {
 
+static_assert(max_mesh_lods == shader::max_mesh_lods);
+// LODs are stored in the 3 least significant bits of draw keys
+static_assert(max_mesh_lods <= 8);
+// Read back as is from the std430 Stats buffer
+static_assert(sizeof(shader::CullingStats) == 48);
+
+// Without pre-pass, calls draw(false) once. Otherwise calls draw(true) to only write depth,
+// then draw(false) with depth test EQUAL and no depth write, so only the visible fragments are shaded.
+template<typename F>
+static void draw_passes(StateCache& cache, bool depth_prepass, F&& draw) {
+    if(!depth_prepass) {
+        draw(false);
+        return;
+    }
+
+    glColorMask(false, false, false, false);
+    draw(true);
+    glColorMask(true, true, true, true);
+
+    cache.lock_depth_state(DepthTestMode::Equal, false);
+    draw(false);
+    cache.unlock_depth_state();
+}
+
 Scene::Scene() {
 }
 
+u32 Scene::resource_id(const void* resource) {
+    return _resource_ids.emplace(resource, u32(_resource_ids.size())).first->second;
+}
+
 void Scene::add_object(SceneObject obj) {
+    if(obj.mesh() && obj.material()) {
+        _object_bounds.push_back(obj.world_bounding_center(), obj.world_bounding_radius());
+
+        const u64 program_id = resource_id(obj.material()->program().get());
+        const u64 material_id = resource_id(obj.material().get());
+        const u64 mesh_id = resource_id(obj.mesh().get());
+        _object_draw_keys.push_back(((program_id & 0xFFFF) << 48) | ((material_id & 0xFFFFFF) << 24) | ((mesh_id & 0x1FFFFF) << 3));
+        _material_data_dirty |= obj.material()->is_bindless();
+    } else {
+        // Objects without mesh or material are never drawn
+        _object_bounds.push_back(glm::vec3(0.0f), -std::numeric_limits<float>::infinity());
+        _object_draw_keys.push_back(0);
+    }
+    _object_lods.push_back(0);
     _objects.emplace_back(std::move(obj));
 }
 
@@ -20,63 +67,735 @@ void Scene::add_object(PointLight obj) {
     _point_lights.emplace_back(std::move(obj));
 }
 
-std::shared_ptr<TypedBuffer<shader::FrameData>> Scene::frame_data_buffer(const Camera& camera) const {
-    std::shared_ptr<TypedBuffer<shader::FrameData>> buffer =
-        std::make_shared<TypedBuffer<shader::FrameData>>(nullptr, 1);
-        
-    auto mapping = buffer->map(AccessType::WriteOnly);
-    mapping[0].camera.view_proj = camera.view_proj_matrix();
-    mapping[0].point_light_count = u32(_point_lights.size());
-    mapping[0].sun_color = glm::vec3(1.0f, 1.0f, 1.0f);
-    mapping[0].sun_dir = glm::normalize(_sun_direction);
-        
-    return buffer;
-}
-
-std::shared_ptr<TypedBuffer<shader::PointLight>> Scene::point_light_buffer() const {
-    std::shared_ptr<TypedBuffer<shader::PointLight>> buffer =
-        std::make_shared<TypedBuffer<shader::PointLight>>(nullptr, std::max(_point_lights.size(), size_t(1)));
-    
-    auto mapping = buffer->map(AccessType::WriteOnly);
-    for(size_t i = 0; i != _point_lights.size(); ++i) {
-        const auto& light = _point_lights[i];
-        mapping[i] = {
-            light.position(),
-            light.radius(),
-            light.color(),
-            0.0f
+void Scene::build_bvh() {
+    std::vector<AABB> bounds;
+    bounds.reserve(_objects.size());
+    for(const SceneObject& obj : _objects) {
+        // Objects without mesh get an empty box that nothing can intersect
+        bounds.push_back(obj.mesh() && obj.material() ? obj.world_bounding_box() : AABB{});
+    }
+    _bvh = BVH(bounds);
+}
+
+Result<RayHit> Scene::pick(const Ray& ray) const {
+    if(_bvh.item_count() != _objects.size()) {
+        return {false, {}};
+    }
+    return _bvh.intersect(ray);
+}
+
+AABB Scene::bounding_box() const {
+    AABB bounds;
+    for(const SceneObject& obj : _objects) {
+        if(obj.mesh()) {
+            bounds.extend(obj.world_bounding_box());
+        }
+    }
+    return bounds;
+}
+
+size_t Scene::point_light_count() const {
+    return _point_lights.size();
+}
+
+Span<const shader::PointLight> Scene::submitted_lights() const {
+    return _submitted_lights;
+}
+
+const SceneObject& Scene::object(u32 index) const {
+    return _objects[index];
+}
+
+bool Scene::can_merge_draws(u32 a, u32 b, bool depth_only) const {
+    const bool same_binds = depth_only || (_object_draw_keys[a] >> 24) == (_object_draw_keys[b] >> 24) ||
+                            _objects[a].material()->has_same_binds(*_objects[b].material());
+    return same_binds && &_objects[a].mesh()->arena() == &_objects[b].mesh()->arena();
+}
+
+void Scene::build_material_data() {
+    _material_data_dirty = false;
+
+    std::vector<shader::MaterialData> materials;
+    for(size_t i = 0; i != _objects.size(); ++i) {
+        const Material* material = _objects[i].material().get();
+        if(!_objects[i].mesh() || !material || !material->is_bindless()) {
+            continue;
+        }
+
+        const u32 material_id = u32((_object_draw_keys[i] >> 24) & 0xFFFFFF);
+        if(materials.size() <= material_id) {
+            materials.resize(material_id + 1, shader::MaterialData{});
+        }
+
+        shader::MaterialData& data = materials[material_id];
+        for(const auto& [slot, texture] : material->textures()) {
+            const u64 handle = texture->bindless_handle();
+            const glm::uvec2 packed(u32(handle), u32(handle >> 32));
+            if(slot == 0) {
+                data.albedo = packed;
+            } else if(slot == 1) {
+                data.normal = packed;
+            }
+        }
+    }
+
+    if(!materials.empty()) {
+        _material_data = TypedBuffer<shader::MaterialData>(materials);
+    }
+}
+
+Material& Scene::draw_material(const SceneObject& obj, bool depth_only) {
+    if(!depth_only) {
+        return *obj.material();
+    }
+
+    const VertexFormat format = obj.mesh()->arena().vertex_format();
+    auto& material = _depth_prepass_materials[size_t(format)];
+    if(!material) {
+        material = std::make_shared<Material>();
+        if(format == VertexFormat::Compact) {
+            material->set_program(Program::from_files("depth.frag", "depth.vert", {"COMPACT_VERTICES"}));
+        } else {
+            material->set_program(Program::from_files("depth.frag", "depth.vert"));
+        }
+    }
+    return *material;
+}
+
+u32 Scene::select_lod(u32 index, const glm::vec3& camera_position, float lod_scale, const RenderSettings& settings) {
+    const SceneObject& obj = _objects[index];
+    const StaticMesh& mesh = *obj.mesh();
+    const u32 lod_count = mesh.lod_count();
+    if(lod_count == 1) {
+        return 0;
+    }
+
+    const float radius = obj.world_bounding_radius();
+    const float distance = std::max(glm::length(obj.world_bounding_center() - camera_position), 1e-4f);
+    // Bounding sphere radius on screen, in pixels
+    const float projected_radius = radius * lod_scale / distance;
+
+    auto pixel_error = [&](u32 lod) {
+        return mesh.lod_error(lod) * projected_radius;
+    };
+
+    // Refine as soon as the error is too large, but only coarsen with some margin
+    u32 lod = std::min(u32(_object_lods[index]), lod_count - 1);
+    while(lod > 0 && pixel_error(lod) > settings.lod_pixel_error) {
+        --lod;
+    }
+    while(lod + 1 < lod_count && pixel_error(lod + 1) <= settings.lod_pixel_error * (1.0f - settings.lod_hysteresis)) {
+        ++lod;
+    }
+
+    _object_lods[index] = u8(lod);
+    return lod;
+}
+
+void Scene::build_gpu_draws() {
+    _gpu_draw_groups.clear();
+    _gpu_draws_object_count = u32(_objects.size());
+
+    std::vector<std::pair<u64, u32>> sorted;
+    for(u32 i = 0; i != _objects.size(); ++i) {
+        if(_objects[i].mesh() && _objects[i].material()) {
+            sorted.emplace_back(_object_draw_keys[i], i);
+        }
+    }
+    std::sort(sorted.begin(), sorted.end());
+
+    if(sorted.empty()) {
+        return;
+    }
+
+    // One draw per key and LOD, with room for all of its objects: cull.comp only fills in instance counts and indices
+    std::vector<shader::ObjectData> objects;
+    std::vector<shader::DrawData> draw_data;
+    std::vector<DrawElementsIndirectCommand> commands;
+    u32 instance_count = 0;
+    objects.reserve(sorted.size());
+    for(size_t begin = 0; begin != sorted.size();) {
+        size_t end = begin + 1;
+        while(end != sorted.size() && sorted[end].first == sorted[begin].first) {
+            ++end;
+        }
+
+        const u32 draw_index = u32(draw_data.size());
+        const u32 first_object = sorted[begin].second;
+        const StaticMesh& mesh = *_objects[first_object].mesh();
+
+        glm::vec4 lod_errors(0.0f);
+        for(u32 lod = 0; lod != mesh.lod_count(); ++lod) {
+            const MeshRange& range = mesh.range(lod);
+            lod_errors[lod] = mesh.lod_error(lod);
+
+            draw_data.push_back({
+                range.position_offset,
+                instance_count,
+                range.position_scale,
+                u32((sorted[begin].first >> 24) & 0xFFFFFF)
+            });
+            commands.push_back({
+                range.index_count,
+                0,
+                range.first_index,
+                i32(range.base_vertex),
+                0
+            });
+            instance_count += u32(end - begin);
+        }
+
+        for(size_t i = begin; i != end; ++i) {
+            objects.push_back({
+                mesh.bounding_center(),
+                mesh.bounding_radius(),
+                sorted[i].second,
+                draw_index,
+                mesh.lod_count(),
+                shader::invalid_draw_index,
+                lod_errors
+            });
+        }
+
+        if(_gpu_draw_groups.empty() || !can_merge_draws(_gpu_draw_groups.back().first_object, first_object)) {
+            _gpu_draw_groups.push_back({draw_index, 0, first_object, false});
+        }
+        _gpu_draw_groups.back().draw_count += mesh.lod_count();
+
+        begin = end;
+    }
+
+    // Objects with meshlets also get a draw of their own, of a single instance whose slot is filled here.
+    // meshlet_cull.comp appends visible meshlets to the object's range of the compacted index buffer, and counts them in the command.
+    std::vector<u32> instances(instance_count, 0);
+    std::vector<shader::MeshletInstance> meshlet_instances;
+    u32 meshlet_index_count = 0;
+    _gpu_meshlet_batches.clear();
+    for(u32 i = 0; i != objects.size(); ++i) {
+        const u32 object_index = objects[i].object_index;
+        const StaticMesh& mesh = *_objects[object_index].mesh();
+        const MeshRange& range = mesh.range();
+        if(!range.meshlet_count) {
+            continue;
+        }
+
+        const u32 draw_index = u32(draw_data.size());
+        objects[i].meshlet_draw_index = draw_index;
+
+        draw_data.push_back({
+            range.position_offset,
+            u32(instances.size()),
+            range.position_scale,
+            u32((_object_draw_keys[object_index] >> 24) & 0xFFFFFF)
+        });
+        commands.push_back({
+            0,
+            1,
+            meshlet_index_count,
+            i32(range.base_vertex),
+            0
+        });
+        instances.push_back(object_index);
+        meshlet_index_count += range.index_count;
+
+        if(!_gpu_draw_groups.back().meshlets || !can_merge_draws(_gpu_draw_groups.back().first_object, object_index)) {
+            _gpu_draw_groups.push_back({draw_index, 0, object_index, true});
+        }
+        ++_gpu_draw_groups.back().draw_count;
+
+        if(_gpu_meshlet_batches.empty() || &_objects[_gpu_meshlet_batches.back().first_object].mesh()->arena() != &mesh.arena()) {
+            _gpu_meshlet_batches.push_back({u32(meshlet_instances.size()), 0, object_index});
+        }
+        _gpu_meshlet_batches.back().instance_count += range.meshlet_count;
+
+        for(u32 m = 0; m != range.meshlet_count; ++m) {
+            meshlet_instances.push_back({i, range.first_meshlet + m, 0, 0});
+        }
+    }
+
+    _gpu_objects = TypedBuffer<shader::ObjectData>(objects);
+    _gpu_draw_data = TypedBuffer<shader::DrawData>(draw_data);
+    _gpu_cleared_commands = TypedBuffer<DrawElementsIndirectCommand>(commands);
+    _gpu_commands = TypedBuffer<DrawElementsIndirectCommand>(commands);
+    _gpu_instance_indices = TypedBuffer<u32>(instances);
+
+    // Nothing was visible in the previous frame
+    const std::vector<u32> visibility(objects.size(), 0);
+    _gpu_visibility = TypedBuffer<u32>(visibility);
+    _gpu_lods = TypedBuffer<u32>(visibility);
+
+    if(!meshlet_instances.empty()) {
+        _gpu_meshlet_instances = TypedBuffer<shader::MeshletInstance>(meshlet_instances);
+        _gpu_meshlet_visibility = TypedBuffer<u32>(visibility);
+        _gpu_meshlet_indices = TypedBuffer<u32>(nullptr, meshlet_index_count);
+    }
+
+    for(auto& counters : _gpu_culling_stats) {
+        if(!counters.byte_size()) {
+            const shader::CullingStats cleared = {};
+            counters = TypedBuffer<shader::CullingStats>(&cleared, 1);
+        }
+    }
+}
+
+void Scene::dispatch_gpu_culling(Program& program, const RenderSettings& settings, float lod_scale) {
+    // Reset every instance count to 0, then let the culling pass append to them
+    _gpu_cleared_commands.copy_to(_gpu_commands, _gpu_commands.byte_size());
+
+    const u32 object_count = u32(_gpu_objects.element_count());
+    program.bind();
+    program.set_uniform(HASH("object_count"), object_count);
+    program.set_uniform(HASH("lod_scale"), lod_scale);
+    program.set_uniform(HASH("lod_pixel_error"), settings.lod_pixel_error);
+    program.set_uniform(HASH("lod_hysteresis"), settings.lod_hysteresis);
+
+    const bool meshlets = settings.meshlet_culling && !_gpu_meshlet_batches.empty();
+    program.set_uniform(HASH("meshlet_culling"), u32(meshlets));
+
+    _object_transforms.bind(BufferUsage::Storage, 2);
+    _gpu_instance_indices.bind(BufferUsage::Storage, 3);
+    _gpu_draw_data.bind(BufferUsage::Storage, 4);
+    _gpu_objects.bind(BufferUsage::Storage, 5);
+    _gpu_commands.bind(BufferUsage::Storage, 6);
+    _gpu_lods.bind(BufferUsage::Storage, 9);
+    if(meshlets) {
+        _gpu_meshlet_visibility.bind(BufferUsage::Storage, 10);
+    }
+    glDispatchCompute(align_up_to(object_count, 64) / 64, 1, 1);
+
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+    if(!meshlets) {
+        return;
+    }
+
+    if(!_meshlet_cull_program) {
+        _meshlet_cull_program = Program::from_file("meshlet_cull.comp");
+    }
+
+    _meshlet_cull_program->bind();
+    _gpu_meshlet_instances.bind(BufferUsage::Storage, 12);
+    _gpu_meshlet_indices.bind(BufferUsage::Storage, 14);
+    for(const GpuMeshletBatch& batch : _gpu_meshlet_batches) {
+        _objects[batch.first_object].mesh()->arena().bind_meshlets(11, 13);
+        _meshlet_cull_program->set_uniform(HASH("first_meshlet_instance"), batch.first_instance);
+        _meshlet_cull_program->set_uniform(HASH("meshlet_instance_count"), batch.instance_count);
+        glDispatchCompute(align_up_to(batch.instance_count, 64) / 64, 1, 1);
+    }
+
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void Scene::draw_gpu_commands(StateCache& cache, bool depth_only, bool meshlets, RenderStats& stats) {
+    _gpu_commands.bind(BufferUsage::Indirect);
+
+    for(size_t begin = 0; begin != _gpu_draw_groups.size();) {
+        const GpuDrawGroup& group = _gpu_draw_groups[begin];
+
+        // Without meshlet culling, meshlet draws stay empty
+        if(group.meshlets && !meshlets) {
+            ++begin;
+            continue;
+        }
+
+        // Groups are split by material, which doesn't matter for depth only draws
+        u32 draw_count = group.draw_count;
+        size_t end = begin + 1;
+        while(depth_only && end != _gpu_draw_groups.size() && _gpu_draw_groups[end].meshlets == group.meshlets &&
+              can_merge_draws(group.first_object, _gpu_draw_groups[end].first_object, true)) {
+            draw_count += _gpu_draw_groups[end++].draw_count;
+        }
+
+        const SceneObject& obj = _objects[group.first_object];
+        Material& material = draw_material(obj, depth_only);
+        material.bind(cache);
+        material.set_uniform(HASH("draw_offset"), group.first_draw);
+        cache.bind_mesh_arena(obj.mesh()->arena(), depth_only, group.meshlets ? &_gpu_meshlet_indices : nullptr);
+
+        const size_t command_offset = group.first_draw * sizeof(DrawElementsIndirectCommand);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, reinterpret_cast<const void*>(command_offset), GLsizei(draw_count), 0);
+
+        ++stats.draw_calls;
+        begin = end;
+    }
+}
+
+void Scene::render_gpu_culled(const RenderSettings& settings, float lod_scale, const Texture* depth, RenderStats& stats) {
+    if(_gpu_draws_object_count != _objects.size()) {
+        build_gpu_draws();
+    }
+
+    if(_gpu_draw_groups.empty()) {
+        return;
+    }
+
+    if(!_cull_program) {
+        _cull_program = Program::from_file("cull.comp");
+        _cull_first_phase_program = Program::from_file("cull.comp", {"FIRST_PHASE"});
+        _cull_second_phase_program = Program::from_file("cull.comp", {"SECOND_PHASE"});
+    }
+
+    // Counters are read back frame_count - 1 frames later, when the GPU is done with them, to avoid stalling
+    {
+        const u32 frame_count = u32(_gpu_culling_stats.size());
+        const auto& ready = _gpu_culling_stats[(_gpu_culling_frame + 1) % frame_count];
+        shader::CullingStats counters = {};
+        ready.read(0, &counters, sizeof(counters));
+        stats.drawn_objects = counters.drawn_objects;
+        stats.culled_objects = counters.culled_objects;
+        stats.occluded_objects = counters.occluded_objects;
+        stats.drawn_triangles = counters.drawn_triangles;
+        stats.drawn_meshlets = counters.drawn_meshlets;
+        stats.culled_meshlets = counters.culled_meshlets;
+        std::copy(std::begin(counters.lod_objects), std::end(counters.lod_objects), stats.lod_objects.begin());
+
+        auto& current = _gpu_culling_stats[_gpu_culling_frame % frame_count];
+        const shader::CullingStats cleared = {};
+        current.write(0, &cleared, sizeof(cleared));
+        current.bind(BufferUsage::Storage, 7);
+        ++_gpu_culling_frame;
+    }
+
+    const auto draw = [&](StateCache& cache) {
+        draw_passes(cache, settings.depth_prepass, [&](bool depth_only) {
+            draw_gpu_commands(cache, depth_only, settings.meshlet_culling, stats);
+        });
+    };
+
+    StateCache cache;
+    if(!settings.occlusion_culling || !depth) {
+        dispatch_gpu_culling(*_cull_program, settings, lod_scale);
+        draw(cache);
+    } else {
+        if(_hi_z.is_null() || _hi_z.depth_size() != depth->size()) {
+            _hi_z = HiZ(depth->size());
+        }
+
+        _gpu_visibility.bind(BufferUsage::Storage, 8);
+
+        // Draw what was visible last frame, then test everything against the resulting depth
+        dispatch_gpu_culling(*_cull_first_phase_program, settings, lod_scale);
+        draw(cache);
+
+        _hi_z.build(*depth);
+        _hi_z.bind(0);
+
+        dispatch_gpu_culling(*_cull_second_phase_program, settings, lod_scale);
+        cache.reset();
+        draw(cache);
+    }
+
+    stats.state_changes = cache.state_changes();
+    stats.avoided_state_changes = cache.avoided_state_changes();
+}
+
+// Conservative NDC rect and view depth range of the light sphere
+static shader::PointLight build_light_data(const PointLight& light, const Camera& camera) {
+    const glm::mat4& proj = camera.projection_matrix();
+    const glm::vec3 center = glm::vec3(camera.view_matrix() * glm::vec4(light.position(), 1.0f));
+    const float radius = light.radius();
+    const float depth = -center.z;
+
+    glm::vec4 rect(-1.0f, -1.0f, 1.0f, 1.0f);
+    // Spheres crossing the near plane cover the whole screen
+    if(depth - radius > proj[3][2]) {
+        glm::vec2 ndc_min(std::numeric_limits<float>::max());
+        glm::vec2 ndc_max(-std::numeric_limits<float>::max());
+        for(u32 i = 0; i != 8; ++i) {
+            const glm::vec3 offset((i & 1) ? radius : -radius, (i & 2) ? radius : -radius, (i & 4) ? radius : -radius);
+            const glm::vec4 clip = proj * glm::vec4(center + offset, 1.0f);
+            const glm::vec2 ndc = glm::vec2(clip) / clip.w;
+            ndc_min = glm::min(ndc_min, ndc);
+            ndc_max = glm::max(ndc_max, ndc);
+        }
+        rect = glm::clamp(glm::vec4(ndc_min, ndc_max), -1.0f, 1.0f);
+    }
+
+    // Widened to stay conservative after rounding to half floats
+    const glm::vec2 depth_range(std::max(depth - radius, 0.0f) * 0.99f, (depth + radius) * 1.01f);
+
+    return {
+        light.position(),
+        radius,
+        light.color(),
+        glm::packHalf2x16(depth_range),
+        rect
+    };
+}
+
+void Scene::cull_lights(const Camera& camera, u32 light_budget) {
+    const Frustum frustum = camera.build_frustum();
+    const glm::vec3 camera_position = camera.position();
+
+    // Visible lights with the distance from the camera to their sphere
+    std::vector<std::pair<float, u32>> visible;
+    for(u32 i = 0; i != _point_lights.size(); ++i) {
+        const PointLight& light = _point_lights[i];
+        if(intersects(frustum, camera_position, light.position(), light.radius())) {
+            const float distance = std::max(0.0f, glm::length(light.position() - camera_position) - light.radius());
+            visible.emplace_back(distance, i);
+        }
+    }
+
+    if(light_budget && visible.size() > light_budget) {
+        std::nth_element(visible.begin(), visible.begin() + light_budget, visible.end());
+        visible.resize(light_budget);
+    }
+
+    _submitted_lights.clear();
+    _submitted_lights.reserve(visible.size());
+    for(const auto& [distance, index] : visible) {
+        _submitted_lights.push_back(build_light_data(_point_lights[index], camera));
+    }
+}
+
+void Scene::update_frame_data(const Camera& camera, const RenderSettings& settings) {
+    cull_lights(camera, settings.light_budget);
+
+    // Buffers are created on first use so scenes can be built away from the GL thread
+    if(_frame_data.is_null()) {
+        _frame_data = RingBuffer<shader::FrameData>(1);
+    }
+
+    {
+        auto mapping = _frame_data.map_next();
+        mapping[0].camera.view_proj = camera.view_proj_matrix();
+        mapping[0].camera.view = camera.view_matrix();
+        mapping[0].camera.proj = camera.projection_matrix();
+        mapping[0].camera.position = camera.position();
+
+        const Frustum frustum = camera.build_frustum();
+        const glm::vec3 normals[] = {
+            frustum._near_normal,
+            frustum._top_normal,
+            frustum._bottom_normal,
+            frustum._right_normal,
+            frustum._left_normal,
         };
+        for(size_t i = 0; i != std::size(normals); ++i) {
+            mapping[0].camera.frustum_planes[i] = glm::vec4(normals[i], -glm::dot(normals[i], camera.position()));
+        }
+
+        mapping[0].point_light_count = u32(_submitted_lights.size());
+        mapping[0].sun_color = glm::vec3(1.0f, 1.0f, 1.0f);
+        mapping[0].sun_dir = glm::normalize(_sun_direction);
     }
 
-    return buffer;
+    const size_t light_capacity = std::max(_submitted_lights.size(), size_t(1));
+    if(_point_light_data.element_count() < light_capacity) {
+        _point_light_data = RingBuffer<shader::PointLight>(light_capacity);
+    }
+
+    {
+        auto mapping = _point_light_data.map_next();
+        std::copy(_submitted_lights.begin(), _submitted_lights.end(), mapping.data());
+    }
+}
+
+void Scene::bind_frame_data() const {
+    _frame_data.bind(BufferUsage::Uniform, 0);
+    _point_light_data.bind(BufferUsage::Storage, 1);
+}
+
+void Scene::stream_textures(const Camera& camera, const RenderSettings& settings) {
+    std::vector<u32> visible;
+    _object_bounds.cull(camera.build_frustum(), camera.position(), visible);
+
+    const glm::vec3 camera_position = camera.position();
+    const float lod_scale = camera.projection_matrix()[1][1] * 0.5f * float(settings.viewport_height);
+    for(const u32 index : visible) {
+        const SceneObject& obj = _objects[index];
+        const float distance = std::max(glm::length(obj.world_bounding_center() - camera_position), 1e-4f);
+        // Bounding sphere diameter on screen, in pixels: textures are assumed to be mapped once across the object
+        const float screen_size = 2.0f * obj.world_bounding_radius() * lod_scale / distance;
+        for(const auto& texture : obj.material()->textures()) {
+            _texture_streamer.request(texture.second.get(), screen_size);
+        }
+    }
+
+    _texture_streamer.update(u64(settings.texture_budget_mb) * 1024 * 1024, settings.texture_upload_ms / 1000.0);
+
+    // Reallocated textures have new bindless handles
+    const TextureStreamer::Stats& stats = _texture_streamer.stats();
+    _material_data_dirty |= has_bindless_textures() && stats.uploaded_levels + stats.evicted_levels != 0;
 }
 
-void Scene::render(const Camera& camera) const {
-    // Fill and bind frame data buffer
-    const std::shared_ptr<TypedBuffer<shader::FrameData>> frame_buffer = frame_data_buffer(camera);
-    frame_buffer->bind(BufferUsage::Uniform, 0);
+TextureStreamer& Scene::texture_streamer() {
+    return _texture_streamer;
+}
 
-    // Fill and bind lights buffer
-    const std::shared_ptr<TypedBuffer<shader::PointLight>> light_buffer = point_light_buffer();
-    light_buffer->bind(BufferUsage::Storage, 1);
+const TextureStreamer& Scene::texture_streamer() const {
+    return _texture_streamer;
+}
 
-    std::unordered_map<Material*, std::vector<const SceneObject *>> objects_by_material =
-        std::unordered_map<Material*, std::vector<const SceneObject*>>();
+RenderStats Scene::render(const Camera& camera, const RenderSettings& settings, const Texture* depth) {
+    bind_frame_data();
 
-    for (const SceneObject &obj : _objects) {
-        // FRUSTUM CULLING ?
+    RenderStats stats;
+    stats.submitted_lights = u32(_submitted_lights.size());
+    stats.culled_lights = u32(_point_lights.size() - _submitted_lights.size());
 
-        Material* material_ptr = obj.material().get();
-        objects_by_material[material_ptr].push_back(&obj);
+    if(_objects.empty()) {
+        return stats;
     }
 
-    for (const auto& [material, objects] : objects_by_material) {
-        for (const SceneObject *obj : objects) {
-            material->set_uniform(HASH("model"), obj->transform());
-            material->bind();
-            obj->mesh()->draw();
+    if(_object_transforms.element_count() != _objects.size()) {
+        std::vector<glm::mat4> transforms;
+        transforms.reserve(_objects.size());
+        for(const SceneObject& obj : _objects) {
+            transforms.push_back(obj.transform());
         }
+        _object_transforms = TypedBuffer<glm::mat4>(transforms);
     }
+
+    if(_material_data_dirty) {
+        build_material_data();
+    }
+    if(_material_data.element_count()) {
+        _material_data.bind(BufferUsage::Storage, 15);
+    }
+
+    // Converts radius / distance to pixels on screen
+    const float lod_scale = camera.projection_matrix()[1][1] * 0.5f * float(settings.viewport_height);
+
+    if(settings.gpu_culling) {
+        render_gpu_culled(settings, lod_scale, depth, stats);
+        return stats;
+    }
+
+    std::vector<u32> visible;
+    {
+        const double culling_start = program_time();
+        const bool use_bvh = settings.bvh_culling && !_bvh.is_empty() && _bvh.item_count() == _objects.size();
+        if(use_bvh) {
+            _bvh.cull(camera.build_frustum(), camera.position(), visible);
+        } else {
+            _object_bounds.cull(camera.build_frustum(), camera.position(), visible);
+        }
+        stats.culling_time = program_time() - culling_start;
+        stats.culled_objects = u32(_objects.size() - visible.size());
+    }
+
+    // Draws sharing a program, material, mesh or LOD end up next to each other
+    std::vector<std::pair<u64, u32>> draws;
+    draws.reserve(visible.size());
+    {
+        const glm::vec3 camera_position = camera.position();
+        for(const u32 index : visible) {
+            const u32 lod = select_lod(index, camera_position, lod_scale, settings);
+            ++stats.lod_objects[lod];
+            draws.emplace_back(_object_draw_keys[index] | lod, index);
+        }
+    }
+    std::sort(draws.begin(), draws.end());
+
+    // Consecutive draws with the same key share program, material, mesh and LOD: each run is one instanced draw
+    std::vector<std::pair<u32, u32>> batches;
+    for(size_t begin = 0; begin != draws.size();) {
+        size_t end = begin + 1;
+        while(end != draws.size() && draws[end].first == draws[begin].first) {
+            ++end;
+        }
+        batches.emplace_back(u32(begin), u32(end));
+        begin = end;
+    }
+
+    auto draw_lod = [&](const std::pair<u32, u32>& batch) {
+        return u32(draws[batch.first].first & 0x7);
+    };
+
+    const size_t instance_capacity = std::max(draws.size(), size_t(1));
+    if(_instance_indices.element_count() < instance_capacity) {
+        _instance_indices = RingBuffer<u32>(instance_capacity);
+    }
+
+    const size_t draw_capacity = std::max(batches.size(), size_t(1));
+    if(_draw_data.element_count() < draw_capacity) {
+        _draw_data = RingBuffer<shader::DrawData>(draw_capacity);
+        _draw_commands = RingBuffer<DrawElementsIndirectCommand>(draw_capacity);
+    }
+
+    {
+        auto mapping = _instance_indices.map_next();
+        for(size_t i = 0; i != draws.size(); ++i) {
+            mapping[i] = draws[i].second;
+        }
+    }
+
+    {
+        auto draw_mapping = _draw_data.map_next();
+        auto command_mapping = _draw_commands.map_next();
+        for(size_t i = 0; i != batches.size(); ++i) {
+            const auto [begin, end] = batches[i];
+            const MeshRange& range = _objects[draws[begin].second].mesh()->range(draw_lod(batches[i]));
+            stats.drawn_triangles += u64(range.index_count / 3) * (end - begin);
+
+            draw_mapping[i] = {
+                range.position_offset,
+                begin,
+                range.position_scale,
+                u32((draws[begin].first >> 24) & 0xFFFFFF)
+            };
+            command_mapping[i] = {
+                range.index_count,
+                end - begin,
+                range.first_index,
+                i32(range.base_vertex),
+                0
+            };
+        }
+    }
+
+    _object_transforms.bind(BufferUsage::Storage, 2);
+    _instance_indices.bind(BufferUsage::Storage, 3);
+    _draw_data.bind(BufferUsage::Storage, 4);
+
+    StateCache cache;
+    draw_passes(cache, settings.depth_prepass, [&](bool depth_only) {
+        if(settings.multi_draw) {
+            _draw_commands.bind(BufferUsage::Indirect);
+
+            // Batches using the same material and arena only differ by their command: submit them with one call
+            for(size_t begin = 0; begin != batches.size();) {
+                const u32 first_object = draws[batches[begin].first].second;
+                const SceneObject& obj = _objects[first_object];
+
+                size_t end = begin + 1;
+                while(end != batches.size() && can_merge_draws(first_object, draws[batches[end].first].second, depth_only)) {
+                    ++end;
+                }
+
+                Material& material = draw_material(obj, depth_only);
+                material.bind(cache);
+                material.set_uniform(HASH("draw_offset"), u32(begin));
+                cache.bind_mesh_arena(obj.mesh()->arena(), depth_only);
+
+                const size_t command_offset = _draw_commands.slot_byte_offset() + begin * sizeof(DrawElementsIndirectCommand);
+                glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, reinterpret_cast<const void*>(command_offset), GLsizei(end - begin), 0);
+
+                ++stats.draw_calls;
+                begin = end;
+            }
+        } else {
+            for(size_t i = 0; i != batches.size(); ++i) {
+                const auto [begin, end] = batches[i];
+                const SceneObject& obj = _objects[draws[begin].second];
+
+                Material& material = draw_material(obj, depth_only);
+                material.bind(cache);
+                material.set_uniform(HASH("draw_offset"), u32(i));
+                obj.mesh()->draw(cache, end - begin, depth_only, draw_lod(batches[i]));
+
+                ++stats.draw_calls;
+            }
+        }
+    });
+    stats.drawn_objects = u32(draws.size());
+
+    stats.state_changes = cache.state_changes();
+    stats.avoided_state_changes = cache.avoided_state_changes();
+
+    return stats;
 }
 
 }
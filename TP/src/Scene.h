@@ -6,12 +6,69 @@
 #include <SceneObject.h>
 #include <PointLight.h>
 #include <Camera.h>
+#include <BoundsTable.h>
+#include <BVH.h>
+#include <RingBuffer.h>
+#include <TypedBuffer.h>
+#include <HiZ.h>
+#include <TextureStreamer.h>
 
+#include <array>
 #include <vector>
 #include <memory>
+#include <unordered_map>
 
 namespace OM3D {
 
+class StateCache;
+
+struct RenderSettings {
+    bool bvh_culling = true;
+    bool multi_draw = true;
+    // Culls and builds indirect draws in a compute shader, object counts are read back a few frames late
+    bool gpu_culling = false;
+    // Two-phase Hi-Z occlusion culling, only with GPU culling
+    bool occlusion_culling = false;
+    // Culls the meshlets of large meshes at full detail by frustum and normal cone, only with GPU culling
+    bool meshlet_culling = false;
+    // Draws depth first, so the G-buffer pass only shades visible fragments
+    bool depth_prepass = false;
+    // Maximum number of lights sent to the GPU, 0 for no limit
+    u32 light_budget = 0;
+
+    // Largest simplification error allowed on screen when picking LODs, in pixels. 0 only allows lossless LODs.
+    float lod_pixel_error = 1.0f;
+    // Height of the viewport in pixels, to project errors on screen
+    u32 viewport_height = 1080;
+    // Objects only switch to a coarser LOD once its error is this fraction under the limit, so they don't pop back and forth
+    float lod_hysteresis = 0.25f;
+
+    // GPU memory for textures. Mip tails stay resident even past it.
+    u32 texture_budget_mb = 512;
+    // Time spent uploading texture levels per frame, at least one level is uploaded when needed
+    float texture_upload_ms = 2.0f;
+};
+
+struct RenderStats {
+    u32 drawn_objects = 0;
+    u32 culled_objects = 0;
+    u32 occluded_objects = 0;
+    u32 drawn_meshlets = 0;
+    u32 culled_meshlets = 0;
+    u32 draw_calls = 0;
+    double culling_time = 0.0;
+
+    // Drawn objects at each LOD, and their triangle count
+    std::array<u32, max_mesh_lods> lod_objects = {};
+    u64 drawn_triangles = 0;
+
+    u32 state_changes = 0;
+    u32 avoided_state_changes = 0;
+
+    u32 submitted_lights = 0;
+    u32 culled_lights = 0;
+};
+
 class Scene : NonMovable {
 
     public:
@@ -19,18 +76,136 @@ class Scene : NonMovable {
 
         static Result<std::unique_ptr<Scene>> from_gltf(const std::string& file_name);
 
-        std::shared_ptr<TypedBuffer<shader::FrameData>> frame_data_buffer(const Camera& camera) const;
-        std::shared_ptr<TypedBuffer<shader::PointLight>> point_light_buffer() const;
+        // Writes this frame's data and lights into the next slot of their ring buffers. Call once per frame.
+        // Only lights intersecting the frustum are written, nearest first when over the light budget.
+        void update_frame_data(const Camera& camera, const RenderSettings& settings = {});
+        // Binds the frame data (uniform 0) and light (storage 1) buffers written by the last update
+        void bind_frame_data() const;
+
+        // Raises the residency of textures used by visible objects, according to their size on screen. Call once per frame.
+        void stream_textures(const Camera& camera, const RenderSettings& settings = {});
+        // Textures are added by the scene loader
+        TextureStreamer& texture_streamer();
+        const TextureStreamer& texture_streamer() const;
 
-        void render(const Camera& camera) const;
+        // depth is the depth buffer being rendered to, required by occlusion culling
+        RenderStats render(const Camera& camera, const RenderSettings& settings = {}, const Texture* depth = nullptr);
 
         void add_object(SceneObject obj);
         void add_object(PointLight obj);
 
+        // Builds the BVH over the objects currently in the scene. Objects added afterwards disable it.
+        void build_bvh();
+
+        Result<RayHit> pick(const Ray& ray) const;
+
+        // Bounds of every object with a mesh
+        AABB bounding_box() const;
+        size_t point_light_count() const;
+        // Lights written by the last update_frame_data(), in buffer order
+        Span<const shader::PointLight> submitted_lights() const;
+        const SceneObject& object(u32 index) const;
+
     private:
+        u32 resource_id(const void* resource);
+
+        void cull_lights(const Camera& camera, u32 light_budget);
+
+        // Objects a and b use materials with the same binds (ignored for depth only draws) and the same mesh arena,
+        // so their draws can be submitted together
+        bool can_merge_draws(u32 a, u32 b, bool depth_only = false) const;
+        Material& draw_material(const SceneObject& obj, bool depth_only);
+
+        // lod_scale converts radius / distance to pixels
+        u32 select_lod(u32 index, const glm::vec3& camera_position, float lod_scale, const RenderSettings& settings);
+
+        // Bindless handles of every material, written at its resource id
+        void build_material_data();
+
+        void build_gpu_draws();
+        void render_gpu_culled(const RenderSettings& settings, float lod_scale, const Texture* depth, RenderStats& stats);
+        void dispatch_gpu_culling(Program& program, const RenderSettings& settings, float lod_scale);
+        void draw_gpu_commands(StateCache& cache, bool depth_only, bool meshlets, RenderStats& stats);
+
         std::vector<SceneObject> _objects;
+        // Sort keys: program, material and mesh ids from most to least significant.
+        // The 3 least significant bits are left for the LOD, picked every frame.
+        std::vector<u64> _object_draw_keys;
+        // LOD of every object in the last frame
+        std::vector<u8> _object_lods;
+        std::unordered_map<const void*, u32> _resource_ids;
+
+        // Material textures of bindless programs (storage 15), rebuilt when objects or texture residency change
+        TypedBuffer<shader::MaterialData> _material_data;
+        bool _material_data_dirty = false;
+
+        BoundsTable _object_bounds;
+        BVH _bvh;
         std::vector<PointLight> _point_lights;
+        std::vector<shader::PointLight> _submitted_lights;
         glm::vec3 _sun_direction = glm::vec3(0.2f, 1.0f, 0.1f);
+
+        RingBuffer<shader::FrameData> _frame_data;
+        RingBuffer<shader::PointLight> _point_light_data;
+
+        // Model matrices of every object (storage 2), and per frame indices of the drawn instances (storage 3)
+        TypedBuffer<glm::mat4> _object_transforms;
+        RingBuffer<u32> _instance_indices;
+
+        // Per frame draw data (storage 4) and matching indirect commands, one of each per instanced draw
+        RingBuffer<shader::DrawData> _draw_data;
+        RingBuffer<DrawElementsIndirectCommand> _draw_commands;
+
+        // GPU culling: static draws covering every object, whose instances are filled each frame by cull.comp
+        struct GpuDrawGroup {
+            u32 first_draw;
+            u32 draw_count;
+            u32 first_object;
+            // Meshlet draws index _gpu_meshlet_indices instead of their arena's index buffer
+            bool meshlets;
+        };
+
+        // Meshlet instances of objects sharing an arena, culled by one dispatch
+        struct GpuMeshletBatch {
+            u32 first_instance;
+            u32 instance_count;
+            u32 first_object;
+        };
+
+        std::vector<GpuDrawGroup> _gpu_draw_groups;
+        std::vector<GpuMeshletBatch> _gpu_meshlet_batches;
+        u32 _gpu_draws_object_count = 0;
+
+        TypedBuffer<shader::ObjectData> _gpu_objects;
+        TypedBuffer<shader::DrawData> _gpu_draw_data;
+        TypedBuffer<DrawElementsIndirectCommand> _gpu_cleared_commands;
+        TypedBuffer<DrawElementsIndirectCommand> _gpu_commands;
+        TypedBuffer<u32> _gpu_instance_indices;
+        // Per object visibility of the last frame, for occlusion culling
+        TypedBuffer<u32> _gpu_visibility;
+        // Per object LOD of the last frame
+        TypedBuffer<u32> _gpu_lods;
+
+        // Meshlet culling: every meshlet of every object with meshlets, the objects whose meshlets are drawn this pass,
+        // and the index buffer meshlet_cull.comp compacts visible meshlets into, with a range for each object
+        TypedBuffer<shader::MeshletInstance> _gpu_meshlet_instances;
+        TypedBuffer<u32> _gpu_meshlet_visibility;
+        TypedBuffer<u32> _gpu_meshlet_indices;
+
+        std::array<TypedBuffer<shader::CullingStats>, 3> _gpu_culling_stats;
+        u32 _gpu_culling_frame = 0;
+
+        HiZ _hi_z;
+
+        std::shared_ptr<Program> _cull_program;
+        std::shared_ptr<Program> _cull_first_phase_program;
+        std::shared_ptr<Program> _cull_second_phase_program;
+        std::shared_ptr<Program> _meshlet_cull_program;
+
+        // One per vertex format
+        std::array<std::shared_ptr<Material>, 2> _depth_prepass_materials;
+
+        TextureStreamer _texture_streamer;
 };
 
 }
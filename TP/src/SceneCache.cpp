@@ -0,0 +1,514 @@
+#include "SceneLoader.h"
+
+#include <MappedFile.h>
+#include <TextureCompressor.h>
+#include <ThreadPool.h>
+
+#include <glm/common.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+namespace OM3D {
+
+static constexpr u32 cooked_magic = 0x4B4F4F43; // "COOK"
+// Bump whenever the layout of anything stored raw changes (Vertex, ImageFormat values, ObjectData...) or the import pipeline does
+static constexpr u32 cooked_version = 5;
+static constexpr size_t blob_alignment = 16;
+
+struct CookedHeader {
+    u32 magic;
+    u32 version;
+
+    // Identifies the source file the scene was cooked from
+    u64 source_size;
+    i64 source_mtime;
+    u64 source_hash;
+
+    u32 mesh_count;
+    u32 texture_count;
+    u32 material_count;
+    u32 object_count;
+};
+
+struct CookedMesh {
+    u64 vertex_offset;
+    u64 index_offset;
+    u64 meshlet_offset;
+    u32 vertex_count;
+    u32 index_count;
+    u32 meshlet_count;
+
+    // Used in place: MeshView::lods points into the mapped table
+    u32 lod_count;
+    MeshLod lods[max_mesh_lods];
+};
+
+struct CookedTexture {
+    u64 offset;
+    u64 byte_size;
+    u32 width;
+    u32 height;
+    u32 format;
+    u32 mip_count;
+};
+
+static_assert(std::is_trivially_copyable_v<Vertex>);
+static_assert(std::is_trivially_copyable_v<MeshLod>);
+static_assert(std::is_trivially_copyable_v<shader::Meshlet>);
+static_assert(std::is_trivially_copyable_v<SceneData::MaterialData>);
+static_assert(std::is_trivially_copyable_v<SceneData::ObjectData>);
+
+struct SourceKey {
+    u64 size = 0;
+    i64 mtime = 0;
+};
+
+static Result<SourceKey> source_key(const std::string& file_name) {
+    std::error_code ec;
+    const auto size = std::filesystem::file_size(file_name, ec);
+    if(ec) {
+        return {false, {}};
+    }
+    const auto mtime = std::filesystem::last_write_time(file_name, ec);
+    if(ec) {
+        return {false, {}};
+    }
+    return {true, SourceKey{u64(size), i64(mtime.time_since_epoch().count())}};
+}
+
+// FNV-1a, eight bytes at a time
+static Result<u64> hash_file(const std::string& file_name) {
+    const auto file = MappedFile::from_file(file_name);
+    if(!file.is_ok) {
+        return {false, {}};
+    }
+
+    const Span<const u8> data = file.value->data();
+    u64 hash = 0xcbf29ce484222325;
+    size_t i = 0;
+    for(; i + sizeof(u64) <= data.size(); i += sizeof(u64)) {
+        u64 word = 0;
+        std::memcpy(&word, data.data() + i, sizeof(u64));
+        hash = (hash ^ word) * 0x100000001b3;
+    }
+    for(; i != data.size(); ++i) {
+        hash = (hash ^ data[i]) * 0x100000001b3;
+    }
+    return {true, hash};
+}
+
+static float sRGB_to_linear(float c) {
+    return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static float linear_to_sRGB(float c) {
+    return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+}
+
+// Box filtered mip chain, levels stored one after the other. Only 8 bits formats are supported, others keep a single level.
+static std::vector<u8> build_mip_chain(const SceneData::TexturePayload& texture, u32& mip_count) {
+    const bool is_sRGB = texture.format == ImageFormat::RGBA8_sRGB || texture.format == ImageFormat::RGB8_sRGB;
+    const bool is_8bits = is_sRGB || texture.format == ImageFormat::RGBA8_UNORM || texture.format == ImageFormat::RGB8_UNORM;
+
+    std::vector<u8> mips(texture.data.begin(), texture.data.end());
+    mip_count = 1;
+    if(!is_8bits) {
+        return mips;
+    }
+
+    const u32 channels = bytes_per_pixel(texture.format);
+    auto to_float = [&](u8 value, u32 channel) {
+        const float f = float(value) / 255.0f;
+        return is_sRGB && channel < 3 ? sRGB_to_linear(f) : f;
+    };
+    auto to_u8 = [&](float value, u32 channel) {
+        const float f = is_sRGB && channel < 3 ? linear_to_sRGB(value) : value;
+        return u8(std::clamp(f * 255.0f + 0.5f, 0.0f, 255.0f));
+    };
+
+    const u32 level_count = Texture::mip_levels(texture.size);
+    size_t src_offset = 0;
+    glm::uvec2 src_size = texture.size;
+    for(u32 level = 1; level != level_count; ++level) {
+        const glm::uvec2 dst_size = glm::max(glm::uvec2(1), src_size / 2u);
+        const size_t dst_offset = mips.size();
+        mips.resize(dst_offset + size_t(dst_size.x) * dst_size.y * channels);
+
+        for(u32 y = 0; y != dst_size.y; ++y) {
+            for(u32 x = 0; x != dst_size.x; ++x) {
+                const u32 xs[] = {std::min(x * 2, src_size.x - 1), std::min(x * 2 + 1, src_size.x - 1)};
+                const u32 ys[] = {std::min(y * 2, src_size.y - 1), std::min(y * 2 + 1, src_size.y - 1)};
+                for(u32 c = 0; c != channels; ++c) {
+                    float sum = 0.0f;
+                    for(const u32 sy : ys) {
+                        for(const u32 sx : xs) {
+                            sum += to_float(mips[src_offset + (size_t(sy) * src_size.x + sx) * channels + c], c);
+                        }
+                    }
+                    mips[dst_offset + (size_t(y) * dst_size.x + x) * channels + c] = to_u8(sum * 0.25f, c);
+                }
+            }
+        }
+
+        src_offset = dst_offset;
+        src_size = dst_size;
+    }
+
+    mip_count = level_count;
+    return mips;
+}
+
+// Block compresses every level of a chain built by build_mip_chain, when the texture allows it. Otherwise returns mips as they are.
+static std::vector<u8> compress_mip_chain(const SceneData::TexturePayload& texture, std::vector<u8> mips, u32 mip_count, bool normal_map, ImageFormat& format) {
+    format = texture.format;
+    const auto compressed = block_compressed_format(texture.format, texture.size, texture.data, normal_map);
+    if(!compressed.is_ok || mip_count != Texture::mip_levels(texture.size)) {
+        return mips;
+    }
+
+    std::vector<u8> blocks;
+    size_t offset = 0;
+    for(u32 level = 0; level != mip_count; ++level) {
+        const glm::uvec2 level_size = glm::max(glm::uvec2(1), texture.size >> level);
+        const size_t level_bytes = image_byte_size(texture.format, level_size.x, level_size.y);
+        const size_t block_offset = blocks.size();
+        blocks.resize(block_offset + image_byte_size(compressed.value, level_size.x, level_size.y));
+        compress_image(texture.format, level_size, Span<const u8>(mips.data() + offset, level_bytes), compressed.value, blocks.data() + block_offset);
+        offset += level_bytes;
+    }
+
+    format = compressed.value;
+    return blocks;
+}
+
+// Bytes of the first mip_count levels, stored one after the other
+static u64 mip_chain_bytes(const glm::uvec2& size, ImageFormat format, u32 mip_count) {
+    u64 bytes = 0;
+    for(u32 level = 0; level != mip_count; ++level) {
+        const glm::uvec2 level_size = glm::max(glm::uvec2(1), size >> level);
+        bytes += image_byte_size(format, level_size.x, level_size.y);
+    }
+    return bytes;
+}
+
+std::string SceneData::cooked_file_name(const std::string& file_name) {
+    return file_name + ".cooked";
+}
+
+Result<SceneData> SceneData::from_cooked(const std::string& file_name, const std::string& source_file_name) {
+    auto file = MappedFile::from_file(file_name);
+    if(!file.is_ok) {
+        return {false, {}};
+    }
+
+    const Span<const u8> bytes = file.value->data();
+    if(bytes.size() < sizeof(CookedHeader)) {
+        return {false, {}};
+    }
+
+    CookedHeader header = {};
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if(header.magic != cooked_magic || header.version != cooked_version) {
+        return {false, {}};
+    }
+
+    {
+        const auto key = source_key(source_file_name);
+        if(!key.is_ok || key.value.size != header.source_size) {
+            return {false, {}};
+        }
+        // A different modification time alone does not mean the content changed
+        if(key.value.mtime != header.source_mtime) {
+            const auto hash = hash_file(source_file_name);
+            if(!hash.is_ok || hash.value != header.source_hash) {
+                return {false, {}};
+            }
+        }
+    }
+
+    size_t offset = sizeof(CookedHeader);
+    auto read_table = [&](auto* begin, u32 count) -> bool {
+        const size_t size = sizeof(*begin) * count;
+        if(offset + size > bytes.size()) {
+            return false;
+        }
+        std::memcpy(begin, bytes.data() + offset, size);
+        offset += size;
+        return true;
+    };
+
+    std::vector<CookedMesh> meshes(header.mesh_count);
+    std::vector<CookedTexture> textures(header.texture_count);
+
+    SceneData data;
+    data.materials.resize(header.material_count);
+    data.objects.resize(header.object_count);
+
+    if(!read_table(meshes.data(), header.mesh_count) ||
+       !read_table(textures.data(), header.texture_count) ||
+       !read_table(data.materials.data(), header.material_count) ||
+       !read_table(data.objects.data(), header.object_count)) {
+        return {false, {}};
+    }
+
+    for(const MaterialData& material : data.materials) {
+        if(material.albedo >= int(header.texture_count) || material.normal >= int(header.texture_count)) {
+            return {false, {}};
+        }
+    }
+    for(const ObjectData& object : data.objects) {
+        if(object.mesh >= header.mesh_count || object.material >= int(header.material_count)) {
+            return {false, {}};
+        }
+    }
+
+    auto in_file = [&](u64 blob_offset, u64 blob_size) {
+        return blob_offset % blob_alignment == 0 && blob_offset <= bytes.size() && blob_size <= bytes.size() - blob_offset;
+    };
+
+    // Everything points straight into the mapping
+    for(size_t i = 0; i != meshes.size(); ++i) {
+        const CookedMesh& mesh = meshes[i];
+        if(!in_file(mesh.vertex_offset, u64(mesh.vertex_count) * sizeof(Vertex)) ||
+           !in_file(mesh.index_offset, u64(mesh.index_count) * sizeof(u32)) ||
+           !in_file(mesh.meshlet_offset, u64(mesh.meshlet_count) * sizeof(shader::Meshlet))) {
+            return {false, {}};
+        }
+
+        // Indices are read by the GPU as they are
+        const auto* indices = reinterpret_cast<const u32*>(bytes.data() + mesh.index_offset);
+        if(!mesh.vertex_count || mesh.index_count % 3 ||
+           !std::all_of(indices, indices + mesh.index_count, [&](u32 index) { return index < mesh.vertex_count; })) {
+            return {false, {}};
+        }
+
+        if(mesh.lod_count > max_mesh_lods) {
+            return {false, {}};
+        }
+        u64 lod_index_count = 0;
+        for(u32 lod = 0; lod != mesh.lod_count; ++lod) {
+            lod_index_count += mesh.lods[lod].index_count;
+        }
+        if(mesh.lod_count && lod_index_count != mesh.index_count) {
+            return {false, {}};
+        }
+
+        const auto* meshlets = reinterpret_cast<const shader::Meshlet*>(bytes.data() + mesh.meshlet_offset);
+        const u64 lod0_index_count = mesh.lod_count ? mesh.lods[0].index_count : mesh.index_count;
+        for(u32 m = 0; m != mesh.meshlet_count; ++m) {
+            if(u64(meshlets[m].first_index) + u64(meshlets[m].triangle_count) * 3 > lod0_index_count) {
+                return {false, {}};
+            }
+        }
+
+        const size_t lods_offset = sizeof(CookedHeader) + i * sizeof(CookedMesh) + offsetof(CookedMesh, lods);
+        data.meshes.emplace_back(
+            Span<const Vertex>(reinterpret_cast<const Vertex*>(bytes.data() + mesh.vertex_offset), mesh.vertex_count),
+            Span<const u32>(indices, mesh.index_count),
+            Span<const MeshLod>(reinterpret_cast<const MeshLod*>(bytes.data() + lods_offset), mesh.lod_count),
+            Span<const shader::Meshlet>(meshlets, mesh.meshlet_count)
+        );
+    }
+
+    for(const CookedTexture& texture : textures) {
+        if(!in_file(texture.offset, texture.byte_size) || texture.format > u32(ImageFormat::BC5_UNORM)) {
+            return {false, {}};
+        }
+
+        const glm::uvec2 size(texture.width, texture.height);
+        const ImageFormat format = ImageFormat(texture.format);
+        if(!size.x || !size.y || !texture.mip_count || texture.mip_count > Texture::mip_levels(size)) {
+            return {false, {}};
+        }
+        // Textures with a single level get their mips generated, which block compressed formats don't support
+        if(is_block_compressed(format) && texture.mip_count == 1 && Texture::mip_levels(size) != 1) {
+            return {false, {}};
+        }
+        if(texture.byte_size < mip_chain_bytes(size, format, texture.mip_count)) {
+            return {false, {}};
+        }
+
+        data.textures.push_back(TexturePayload{
+            size,
+            format,
+            texture.mip_count,
+            Span<const u8>(bytes.data() + texture.offset, size_t(texture.byte_size))
+        });
+    }
+
+    data.storage = std::shared_ptr<MappedFile>(std::move(file.value));
+    return {true, std::move(data)};
+}
+
+bool SceneData::write_cooked(const std::string& file_name, const std::string& source_file_name) const {
+    const auto key = source_key(source_file_name);
+    const auto hash = hash_file(source_file_name);
+    if(!key.is_ok || !hash.is_ok) {
+        return false;
+    }
+
+    std::vector<bool> normal_maps(textures.size(), false);
+    for(const MaterialData& material : materials) {
+        if(material.normal >= 0) {
+            normal_maps[material.normal] = true;
+        }
+    }
+
+    // Compression also runs in parallel within each texture
+    std::vector<u32> mip_counts(textures.size());
+    std::vector<ImageFormat> formats(textures.size());
+    std::vector<std::vector<u8>> mip_chains(textures.size());
+    std::vector<size_t> uncompressed_bytes(textures.size());
+    const double compression_start = program_time();
+    ThreadPool::global().parallel_for(textures.size(), 1, [&](size_t begin, size_t end) {
+        for(size_t i = begin; i != end; ++i) {
+            mip_chains[i] = build_mip_chain(textures[i], mip_counts[i]);
+            uncompressed_bytes[i] = mip_chains[i].size();
+            mip_chains[i] = compress_mip_chain(textures[i], std::move(mip_chains[i]), mip_counts[i], normal_maps[i], formats[i]);
+        }
+    });
+
+    if(!textures.empty()) {
+        size_t compressed_count = 0;
+        size_t before = 0;
+        size_t after = 0;
+        for(size_t i = 0; i != textures.size(); ++i) {
+            compressed_count += is_block_compressed(formats[i]);
+            before += uncompressed_bytes[i];
+            after += mip_chains[i].size();
+        }
+        std::cout << source_file_name << " textures: " << compressed_count << " / " << textures.size() << " block compressed in "
+                  << std::round((program_time() - compression_start) * 100.0) / 100.0 << "s, "
+                  << (before + 1023) / 1024 << " KB -> " << (after + 1023) / 1024 << " KB" << std::endl;
+    }
+
+    CookedHeader header = {};
+    header.magic = cooked_magic;
+    header.version = cooked_version;
+    header.source_size = key.value.size;
+    header.source_mtime = key.value.mtime;
+    header.source_hash = hash.value;
+    header.mesh_count = u32(meshes.size());
+    header.texture_count = u32(textures.size());
+    header.material_count = u32(materials.size());
+    header.object_count = u32(objects.size());
+
+    // Blobs come after the tables
+    u64 offset = sizeof(CookedHeader)
+        + meshes.size() * sizeof(CookedMesh)
+        + textures.size() * sizeof(CookedTexture)
+        + materials.size() * sizeof(MaterialData)
+        + objects.size() * sizeof(ObjectData);
+
+    auto allocate = [&](u64 size) {
+        offset = (offset + blob_alignment - 1) / blob_alignment * blob_alignment;
+        const u64 blob_offset = offset;
+        offset += size;
+        return blob_offset;
+    };
+
+    std::vector<CookedMesh> cooked_meshes;
+    for(const MeshView& mesh : meshes) {
+        CookedMesh cooked = {};
+        cooked.vertex_count = u32(mesh.vertices.size());
+        cooked.index_count = u32(mesh.indices.size());
+        cooked.lod_count = u32(mesh.lods.size());
+        std::copy(mesh.lods.begin(), mesh.lods.end(), cooked.lods);
+        cooked.vertex_offset = allocate(mesh.vertices.size() * sizeof(Vertex));
+        cooked.index_offset = allocate(mesh.indices.size() * sizeof(u32));
+        cooked.meshlet_count = u32(mesh.meshlets.size());
+        cooked.meshlet_offset = allocate(mesh.meshlets.size() * sizeof(shader::Meshlet));
+        cooked_meshes.push_back(cooked);
+    }
+
+    std::vector<CookedTexture> cooked_textures;
+    for(size_t i = 0; i != textures.size(); ++i) {
+        CookedTexture cooked = {};
+        cooked.byte_size = mip_chains[i].size();
+        cooked.width = textures[i].size.x;
+        cooked.height = textures[i].size.y;
+        cooked.format = u32(formats[i]);
+        cooked.mip_count = mip_counts[i];
+        cooked.offset = allocate(cooked.byte_size);
+        cooked_textures.push_back(cooked);
+    }
+
+    // Write to a temporary file first, so a failed write never leaves a truncated cache behind
+    const std::string tmp_file_name = file_name + ".tmp";
+    bool ok = true;
+    {
+        FILE* file = std::fopen(tmp_file_name.c_str(), "wb");
+        if(!file) {
+            return false;
+        }
+
+        u64 written = 0;
+        auto write = [&](const void* data, size_t size) {
+            ok &= std::fwrite(data, 1, size, file) == size;
+            written += size;
+        };
+        auto write_blob = [&](u64 blob_offset, const void* data, size_t size) {
+            static constexpr u8 padding[blob_alignment] = {};
+            write(padding, size_t(blob_offset - written));
+            write(data, size);
+        };
+
+        write(&header, sizeof(header));
+        write(cooked_meshes.data(), cooked_meshes.size() * sizeof(CookedMesh));
+        write(cooked_textures.data(), cooked_textures.size() * sizeof(CookedTexture));
+        write(materials.data(), materials.size() * sizeof(MaterialData));
+        write(objects.data(), objects.size() * sizeof(ObjectData));
+
+        for(size_t i = 0; i != meshes.size(); ++i) {
+            write_blob(cooked_meshes[i].vertex_offset, meshes[i].vertices.data(), meshes[i].vertices.size() * sizeof(Vertex));
+            write_blob(cooked_meshes[i].index_offset, meshes[i].indices.data(), meshes[i].indices.size() * sizeof(u32));
+            write_blob(cooked_meshes[i].meshlet_offset, meshes[i].meshlets.data(), meshes[i].meshlets.size() * sizeof(shader::Meshlet));
+        }
+        for(size_t i = 0; i != textures.size(); ++i) {
+            write_blob(cooked_textures[i].offset, mip_chains[i].data(), mip_chains[i].size());
+        }
+
+        // Buffered data is only flushed on close, which can fail as well
+        ok &= std::fclose(file) == 0;
+    }
+
+    std::error_code ec;
+    if(ok) {
+        std::filesystem::rename(tmp_file_name, file_name, ec);
+    }
+    if(!ok || ec) {
+        std::filesystem::remove(tmp_file_name, ec);
+        return false;
+    }
+    return true;
+}
+
+Result<SceneData> SceneData::from_file(const std::string& file_name) {
+    const std::string cooked_name = cooked_file_name(file_name);
+    if(auto cooked = from_cooked(cooked_name, file_name); cooked.is_ok) {
+        std::cout << file_name << " loaded from " << cooked_name << std::endl;
+        return cooked;
+    }
+
+    auto data = from_gltf(file_name);
+    if(data.is_ok && !data.value.write_cooked(cooked_name, file_name)) {
+        std::cerr << "Unable to write cooked scene (" << cooked_name << ")" << std::endl;
+        return data;
+    }
+
+    // Textures decoded from glTF have a single level, the cooked scene has the mip chains they are streamed from
+    if(data.is_ok) {
+        if(auto cooked = from_cooked(cooked_name, file_name); cooked.is_ok) {
+            return cooked;
+        }
+    }
+    return data;
+}
+
+}
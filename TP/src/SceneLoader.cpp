@@ -0,0 +1,171 @@
+#include "SceneLoader.h"
+
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+namespace OM3D {
+
+// Only the mip tail of streamed textures is uploaded while loading
+static size_t texture_bytes(const SceneData::TexturePayload& texture) {
+    return size_t(TextureStreamer::initial_bytes(texture.size, texture.format, texture.mip_count));
+}
+
+static size_t mesh_bytes(const MeshView& mesh, VertexFormat format) {
+    // Vertices are uploaded twice: once whole and once in the arena's position stream
+    const size_t vertex_bytes = format == VertexFormat::Compact
+        ? sizeof(CompactVertex) + sizeof(glm::u16vec4)
+        : sizeof(Vertex) + sizeof(glm::vec3);
+    return mesh.vertices.size() * vertex_bytes + mesh.indices.size() * sizeof(u32);
+}
+
+SceneLoader::SceneLoader(std::string file_name, VertexFormat vertex_format) :
+        _file_name(std::move(file_name)),
+        _vertex_format(vertex_format),
+        _start_time(program_time()) {
+
+    _thread = std::thread([this] {
+        _data = SceneData::from_file(_file_name);
+        _decoded = true;
+    });
+}
+
+SceneLoader::~SceneLoader() {
+    wait();
+}
+
+void SceneLoader::wait() {
+    if(_thread.joinable()) {
+        _thread.join();
+    }
+}
+
+void SceneLoader::update(size_t byte_budget) {
+    if(_state == State::Decoding) {
+        if(!_decoded) {
+            return;
+        }
+
+        wait();
+
+        if(!_data.is_ok) {
+            std::cerr << "Unable to load scene (" << _file_name << ")" << std::endl;
+            _state = State::Failed;
+            return;
+        }
+
+        const SceneData& data = _data.value;
+        for(const SceneData::TexturePayload& texture : data.textures) {
+            _total_bytes += texture_bytes(texture);
+        }
+
+        size_t vertex_count = 0;
+        size_t index_count = 0;
+        for(const MeshView& mesh : data.meshes) {
+            _total_bytes += mesh_bytes(mesh, _vertex_format);
+            vertex_count += mesh.vertices.size();
+            index_count += mesh.indices.size();
+        }
+
+        // Allocate the arena once, so uploads never have to grow it
+        _arena = std::make_shared<MeshArena>(_vertex_format);
+        _arena->reserve(vertex_count, index_count);
+
+        // Textures are added to the scene's streamer as they are uploaded
+        _scene = std::make_unique<Scene>();
+
+        _state = State::Uploading;
+    }
+
+    if(_state != State::Uploading) {
+        return;
+    }
+
+    const size_t budget_end = byte_budget > std::numeric_limits<size_t>::max() - _uploaded_bytes
+        ? std::numeric_limits<size_t>::max()
+        : _uploaded_bytes + byte_budget;
+    do {
+        if(!upload_next()) {
+            create_objects();
+            _state = State::Done;
+            std::cout << _file_name << " loaded in " << std::round((program_time() - _start_time) * 100.0) / 100.0 << "s"
+                      << ", " << _arena->vertex_count() << " vertices and " << _arena->index_count() << " indices in " << (_arena->byte_size() + 1023) / 1024 << " KB" << std::endl;
+            return;
+        }
+    } while(_uploaded_bytes < budget_end);
+}
+
+bool SceneLoader::upload_next() {
+    const SceneData& data = _data.value;
+
+    if(_textures.size() < data.textures.size()) {
+        const SceneData::TexturePayload& texture = data.textures[_textures.size()];
+        _textures.push_back(_scene->texture_streamer().add(texture.size, texture.format, texture.data, texture.mip_count, data.storage));
+        _uploaded_bytes += texture_bytes(texture);
+        return true;
+    }
+
+    if(_meshes.size() < data.meshes.size()) {
+        const MeshView& mesh = data.meshes[_meshes.size()];
+        _meshes.push_back(std::make_shared<StaticMesh>(mesh, _arena));
+        _uploaded_bytes += mesh_bytes(mesh, _vertex_format);
+        return true;
+    }
+
+    return false;
+}
+
+void SceneLoader::create_objects() {
+    const SceneData& data = _data.value;
+
+    std::vector<std::shared_ptr<Material>> materials;
+    materials.reserve(data.materials.size());
+    for(const SceneData::MaterialData& mat : data.materials) {
+        if(mat.albedo < 0) {
+            materials.push_back(Material::empty_material(_vertex_format));
+        } else if(mat.normal < 0) {
+            auto material = std::make_shared<Material>(Material::textured_material(_vertex_format));
+            material->set_texture(0u, _textures[mat.albedo]);
+            materials.push_back(std::move(material));
+        } else {
+            auto material = std::make_shared<Material>(Material::textured_normal_mapped_material(_vertex_format));
+            material->set_texture(0u, _textures[mat.albedo]);
+            material->set_texture(1u, _textures[mat.normal]);
+            materials.push_back(std::move(material));
+        }
+    }
+
+    for(const SceneData::ObjectData& obj : data.objects) {
+        auto scene_object = SceneObject(_meshes[obj.mesh], obj.material < 0 ? Material::empty_material(_vertex_format) : materials[obj.material]);
+        scene_object.set_transform(obj.transform);
+        _scene->add_object(std::move(scene_object));
+    }
+
+    _scene->build_bvh();
+
+    _data = {false, {}};
+}
+
+SceneLoader::State SceneLoader::state() const {
+    return _state;
+}
+
+float SceneLoader::progress() const {
+    if(_state == State::Done) {
+        return 1.0f;
+    }
+    return _total_bytes ? float(double(_uploaded_bytes) / double(_total_bytes)) : 0.0f;
+}
+
+const std::string& SceneLoader::file_name() const {
+    return _file_name;
+}
+
+std::unique_ptr<Scene> SceneLoader::take_scene() {
+    if(_state != State::Done) {
+        return nullptr;
+    }
+    return std::move(_scene);
+}
+
+}
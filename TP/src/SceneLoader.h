@@ -0,0 +1,113 @@
+#ifndef SCENELOADER_H
+#define SCENELOADER_H
+
+#include <Scene.h>
+#include <StaticMesh.h>
+#include <Texture.h>
+
+#include <atomic>
+#include <thread>
+
+namespace OM3D {
+
+// CPU side content of a scene. Building it makes no OpenGL call, so it can be done on any thread.
+// Meshes and textures point into storage: freshly decoded glTF data, or a mapped cooked file.
+struct SceneData {
+    struct TexturePayload {
+        glm::uvec2 size = {};
+        ImageFormat format = ImageFormat::RGBA8_UNORM;
+        // Levels are stored one after the other. With a single level, mips are generated on upload.
+        u32 mip_count = 1;
+        Span<const u8> data;
+    };
+
+    struct MaterialData {
+        int albedo = -1;
+        int normal = -1;
+    };
+
+    struct ObjectData {
+        u32 mesh = 0;
+        int material = -1;
+        glm::mat4 transform;
+    };
+
+    std::vector<MeshView> meshes;
+    std::vector<TexturePayload> textures;
+    std::vector<MaterialData> materials;
+    std::vector<ObjectData> objects;
+
+    std::shared_ptr<const void> storage;
+
+    static Result<SceneData> from_gltf(const std::string& file_name);
+
+    // Cooked scenes are written next to their source, with the ".cooked" extension
+    static std::string cooked_file_name(const std::string& file_name);
+    // Fails if the cooked file is missing, or if it was not cooked from the current version of the source
+    static Result<SceneData> from_cooked(const std::string& file_name, const std::string& source_file_name);
+    // Loads the cooked scene when it is up to date, otherwise imports the glTF file, cooks it and loads the result
+    static Result<SceneData> from_file(const std::string& file_name);
+
+    // Textures are stored with their full mip chain, generated on the CPU
+    bool write_cooked(const std::string& file_name, const std::string& source_file_name) const;
+};
+
+// Loads a scene without stalling rendering: the file is parsed and decoded on a background thread,
+// then update() uploads textures and meshes on the GL thread, within a byte budget per call.
+// The scene is only handed out once complete, so it can replace the current one in a single swap.
+class SceneLoader : NonMovable {
+
+    public:
+        enum class State {
+            Decoding,
+            Uploading,
+            Done,
+            Failed
+        };
+
+        // Meshes are uploaded in vertex_format, which only takes effect here: cooked files always store Vertex
+        SceneLoader(std::string file_name, VertexFormat vertex_format = VertexFormat::Standard);
+        ~SceneLoader();
+
+        // Uploads at least one texture or mesh, and stops once byte_budget bytes have been uploaded.
+        // Only call from the GL thread, usually once per frame.
+        void update(size_t byte_budget);
+
+        // Blocks until decoding is done
+        void wait();
+
+        State state() const;
+        // Fraction of the upload done, in [0, 1]
+        float progress() const;
+        const std::string& file_name() const;
+
+        // Returns the scene once the state is Done, nullptr otherwise
+        std::unique_ptr<Scene> take_scene();
+
+    private:
+        bool upload_next();
+        void create_objects();
+
+        std::string _file_name;
+        VertexFormat _vertex_format = VertexFormat::Standard;
+        double _start_time = 0.0;
+
+        std::thread _thread;
+        std::atomic<bool> _decoded = false;
+        // Written by the decoding thread before it sets _decoded
+        Result<SceneData> _data = {false, {}};
+
+        State _state = State::Decoding;
+
+        std::unique_ptr<Scene> _scene;
+        std::shared_ptr<MeshArena> _arena;
+        std::vector<std::shared_ptr<Texture>> _textures;
+        std::vector<std::shared_ptr<StaticMesh>> _meshes;
+
+        size_t _uploaded_bytes = 0;
+        size_t _total_bytes = 0;
+};
+
+}
+
+#endif // SCENELOADER_H
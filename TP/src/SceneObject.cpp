@@ -2,6 +2,8 @@
 
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <algorithm>
+
 namespace OM3D {
 
 SceneObject::SceneObject(std::shared_ptr<StaticMesh> mesh, std::shared_ptr<Material> material) :
@@ -9,16 +11,6 @@ SceneObject::SceneObject(std::shared_ptr<StaticMesh> mesh, std::shared_ptr<Mater
     _material(std::move(material)) {
 }
 
-void SceneObject::render() const {
-    if(!_material || !_mesh) {
-        return;
-    }
-
-    _material->set_uniform(HASH("model"), transform());
-    _material->bind();
-    _mesh->draw();
-}
-
 void SceneObject::set_transform(const glm::mat4& tr) {
     _transform = tr;
 }
@@ -35,4 +27,33 @@ const glm::mat4& SceneObject::transform() const {
     return _transform;
 }
 
+glm::vec3 SceneObject::world_bounding_center() const {
+    return glm::vec3(_transform * glm::vec4(_mesh->bounding_center(), 1.0f));
+}
+
+float SceneObject::world_bounding_radius() const {
+    // Use the largest axis scale so the sphere stays conservative under non-uniform scaling
+    const float scale = std::max({
+        glm::length(glm::vec3(_transform[0])),
+        glm::length(glm::vec3(_transform[1])),
+        glm::length(glm::vec3(_transform[2]))
+    });
+    return _mesh->bounding_radius() * scale;
+}
+
+AABB SceneObject::world_bounding_box() const {
+    const AABB& box = _mesh->bounding_box();
+
+    AABB world_box;
+    for(u32 i = 0; i != 8; ++i) {
+        const glm::vec3 corner(
+            (i & 1) ? box.max.x : box.min.x,
+            (i & 2) ? box.max.y : box.min.y,
+            (i & 4) ? box.max.z : box.min.z
+        );
+        world_box.extend(glm::vec3(_transform * glm::vec4(corner, 1.0f)));
+    }
+    return world_box;
+}
+
 }
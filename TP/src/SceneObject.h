@@ -15,14 +15,16 @@ class SceneObject : NonCopyable {
     public:
         SceneObject(std::shared_ptr<StaticMesh> mesh = nullptr, std::shared_ptr<Material> material = nullptr);
 
-        void render() const;
-
         std::shared_ptr<Material> material() const;
         const std::shared_ptr<StaticMesh>& mesh() const;
 
         void set_transform(const glm::mat4& tr);
         const glm::mat4& transform() const;
 
+        glm::vec3 world_bounding_center() const;
+        float world_bounding_radius() const;
+        AABB world_bounding_box() const;
+
     private:
         glm::mat4 _transform = glm::mat4(1.0f);
 
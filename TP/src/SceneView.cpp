@@ -2,7 +2,7 @@
 
 namespace OM3D {
 
-SceneView::SceneView(const Scene* scene) : _scene(scene) {
+SceneView::SceneView(Scene* scene) : _scene(scene) {
 }
 
 Camera& SceneView::camera() {
@@ -13,10 +13,11 @@ const Camera& SceneView::camera() const {
     return _camera;
 }
 
-void SceneView::render() const {
+RenderStats SceneView::render(const RenderSettings& settings, const Texture* depth) const {
     if(_scene) {
-        _scene->render(_camera);
+        return _scene->render(_camera, settings, depth);
     }
+    return {};
 }
 
 }
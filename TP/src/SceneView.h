@@ -8,17 +8,17 @@ namespace OM3D {
 
 class SceneView {
     public:
-        SceneView(const Scene* scene = nullptr);
+        SceneView(Scene* scene = nullptr);
 
         Camera& camera();
         const Camera& camera() const;
 
-        void render() const;
+        RenderStats render(const RenderSettings& settings = {}, const Texture* depth = nullptr) const;
 
         const Scene* scene() const { return _scene; }
 
     private:
-        const Scene* _scene = nullptr;
+        Scene* _scene = nullptr;
         Camera _camera;
 
 };
@@ -1,17 +1,33 @@
 #include "Scene.h"
-#include "StaticMesh.h"
+#include "SceneLoader.h"
 
 #include <glm/gtc/quaternion.hpp>
 
 #include <utils.h>
+#include <ThreadPool.h>
+#include <MeshOptimizer.h>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
 #include <iostream>
+#include <limits>
+#include <map>
 
+#ifdef SIMD_SSE
+#include <immintrin.h>
+#endif
+
+// Images are decoded by from_gltf, not while parsing
 #define TINYGLTF_IMPLEMENTATION
+#define TINYGLTF_NO_STB_IMAGE
 #define TINYGLTF_NO_STB_IMAGE_WRITE
 #define TINYGLTF_NOEXCEPTION
 #include <tinygltf/tiny_gltf.h>
 
+#include <stb/stb_image.h>
+
 namespace OM3D {
 
 static size_t component_count(int type) {
@@ -27,6 +43,50 @@ static size_t component_count(int type) {
     }
 }
 
+// Copies count tightly packed float vectors of size N into the matching attribute of interleaved vertices
+template<size_t N>
+static void copy_packed_attribs(const float* in, u8* out, size_t count) {
+    size_t i = 0;
+#ifdef SIMD_SSE
+    if constexpr(N == 4) {
+        for(; i != count; ++i) {
+            _mm_storeu_ps(reinterpret_cast<float*>(out + i * sizeof(Vertex)), _mm_loadu_ps(in + i * 4));
+        }
+    } else if constexpr(N == 3) {
+        // Loads 4 floats and stores 3: the last vector is left to the scalar loop so we never read past the input
+        for(; i + 1 < count; ++i) {
+            const __m128 v = _mm_loadu_ps(in + i * 3);
+            float* dst = reinterpret_cast<float*>(out + i * sizeof(Vertex));
+            _mm_storel_pi(reinterpret_cast<__m64*>(dst), v);
+            _mm_store_ss(dst + 2, _mm_movehl_ps(v, v));
+        }
+    } else if constexpr(N == 2) {
+        for(; i != count; ++i) {
+            const __m128d v = _mm_load_sd(reinterpret_cast<const double*>(in + i * 2));
+            _mm_store_sd(reinterpret_cast<double*>(out + i * sizeof(Vertex)), v);
+        }
+    }
+#endif
+    for(; i != count; ++i) {
+        std::memcpy(out + i * sizeof(Vertex), in + i * N, N * sizeof(float));
+    }
+}
+
+static void widen_packed_indices(const u16* in, u32* out, size_t count) {
+    size_t i = 0;
+#ifdef SIMD_SSE
+    const __m128i zero = _mm_setzero_si128();
+    for(; i + 8 <= count; i += 8) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_unpacklo_epi16(v, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 4), _mm_unpackhi_epi16(v, zero));
+    }
+#endif
+    for(; i != count; ++i) {
+        out[i] = in[i];
+    }
+}
+
 static bool decode_attrib_buffer(const tinygltf::Model& gltf, const std::string& name, const tinygltf::Accessor& accessor, Span<Vertex> vertices) {
     const tinygltf::BufferView& buffer = gltf.bufferViews[accessor.bufferView];
 
@@ -79,6 +139,11 @@ static bool decode_attrib_buffer(const tinygltf::Model& gltf, const std::string&
             const size_t attrib_size = components * sizeof(value_type);
             const size_t input_stride = buffer.byteStride ? buffer.byteStride : attrib_size;
 
+            if(!normalize && components == size && input_stride == attrib_size) {
+                copy_packed_attribs<size>(reinterpret_cast<const float*>(in_begin), out_begin, accessor.count);
+                return;
+            }
+
             for(size_t i = 0; i != accessor.count; ++i) {
                 const u8* attrib = in_begin + i * input_stride;
                 DEBUG_ASSERT(attrib < in_buffer.data() + in_buffer.size());
@@ -103,13 +168,23 @@ static bool decode_attrib_buffer(const tinygltf::Model& gltf, const std::string&
     return true;
 }
 
-static bool decode_index_buffer(const tinygltf::Model& gltf, const tinygltf::Accessor& accessor, Span<u32> indices) {
+// Fails on indices past vertex_count, which would be read and written out of bounds by the mesh optimizer and the GPU
+static bool decode_index_buffer(const tinygltf::Model& gltf, const tinygltf::Accessor& accessor, Span<u32> indices, size_t vertex_count) {
     const tinygltf::BufferView& buffer = gltf.bufferViews[accessor.bufferView];
 
     auto decode_indices = [&](u32 elem_size, auto convert_index) {
         const u8* in_buffer = gltf.buffers[buffer.buffer].data.data() + buffer.byteOffset + accessor.byteOffset;
         const size_t input_stride = buffer.byteStride ? buffer.byteStride : elem_size;
 
+        if(input_stride == elem_size && elem_size == 2) {
+            widen_packed_indices(reinterpret_cast<const u16*>(in_buffer), indices.data(), accessor.count);
+            return;
+        }
+        if(input_stride == elem_size && elem_size == 4) {
+            std::memcpy(indices.data(), in_buffer, accessor.count * sizeof(u32));
+            return;
+        }
+
         for(size_t i = 0; i != accessor.count; ++i) {
             indices[i] = convert_index(in_buffer + i * input_stride);
         }
@@ -136,13 +211,18 @@ static bool decode_index_buffer(const tinygltf::Model& gltf, const tinygltf::Acc
             return false;
     }
 
+    if(!std::all_of(indices.begin(), indices.end(), [&](u32 index) { return index < vertex_count; })) {
+        std::cerr << "Index out of range" << std::endl;
+        return false;
+    }
+
     return true;
 }
 
 static Result<MeshData> build_mesh_data(const tinygltf::Model& gltf, const tinygltf::Primitive& prim) {
     std::vector<Vertex> vertices;
     for(auto&& [name, id] : prim.attributes) {
-        tinygltf::Accessor accessor = gltf.accessors[id];
+        const tinygltf::Accessor& accessor = gltf.accessors[id];
         if(!accessor.count) {
             continue;
         }
@@ -163,10 +243,14 @@ static Result<MeshData> build_mesh_data(const tinygltf::Model& gltf, const tinyg
     }
 
 
+    if(vertices.empty()) {
+        return {false, {}};
+    }
+
     std::vector<u32> indices;
     {
-        tinygltf::Accessor accessor = gltf.accessors[prim.indices];
-        if(!accessor.count || accessor.sparse.isSparse) {
+        const tinygltf::Accessor& accessor = gltf.accessors[prim.indices];
+        if(!accessor.count || accessor.count % 3 || accessor.sparse.isSparse) {
             return {false, {}};
         }
 
@@ -176,39 +260,39 @@ static Result<MeshData> build_mesh_data(const tinygltf::Model& gltf, const tinyg
             return {false, {}};
         }
 
-        if(!decode_index_buffer(gltf, accessor, indices)) {
+        if(!decode_index_buffer(gltf, accessor, indices, vertices.size())) {
             return {false, {}};
         }
     }
 
-    return {true, MeshData{std::move(vertices), std::move(indices)}};
+    return {true, MeshData{std::move(vertices), std::move(indices), {}, {}}};
+}
+
+// Keeps images encoded while tinygltf parses the file, so from_gltf can decode the ones it needs in parallel
+static bool keep_image_encoded(tinygltf::Image* image, const int, std::string*, std::string*, int, int, const unsigned char* bytes, int size, void*) {
+    image->image.assign(bytes, bytes + size);
+    image->as_is = true;
+    return true;
 }
 
+// Decodes an image kept encoded by keep_image_encoded. Images are expanded to RGBA, as tinygltf does by default.
 static Result<TextureData> build_texture_data(const tinygltf::Image& image, bool as_sRGB) {
-    if(image.bits != 8 && image.pixel_type != TINYGLTF_COMPONENT_TYPE_BYTE && image.pixel_type != TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE) {
-        std::cerr << "Unsupported image format (pixel type)" << std::endl;
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    u8* pixels = stbi_load_from_memory(image.image.data(), int(image.image.size()), &width, &height, &channels, 4);
+    DEFER(stbi_image_free(pixels));
+    if(!pixels || width <= 0 || height <= 0) {
+        std::cerr << "Unable to decode image (" << image.name << "): " << (stbi_failure_reason() ? stbi_failure_reason() : "unknown error") << std::endl;
         return {false, {}};
     }
 
-    ImageFormat format = ImageFormat::RGBA8_UNORM;
-    switch(image.component) {
-        case 3:
-            format = as_sRGB ? ImageFormat::RGB8_sRGB : ImageFormat::RGB8_UNORM;
-        break;
-
-        case 4:
-            format = as_sRGB ? ImageFormat::RGBA8_sRGB : ImageFormat::RGBA8_UNORM;
-        break;
+    const size_t bytes = size_t(width) * height * 4;
+    auto data = std::make_unique<u8[]>(bytes);
+    std::copy_n(pixels, bytes, data.get());
 
-        default:
-            std::cerr << "Unsupported image format (components)" << std::endl;
-            return {false, {}};
-    }
-
-    auto data = std::make_unique<u8[]>(image.image.size());
-    std::copy(image.image.begin(), image.image.end(), data.get());
-
-    return {true, TextureData{std::move(data), glm::uvec2(image.width, image.height), format}};
+    const ImageFormat format = as_sRGB ? ImageFormat::RGBA8_sRGB : ImageFormat::RGBA8_UNORM;
+    return {true, TextureData{std::move(data), glm::uvec2(width, height), format}};
 }
 
 
@@ -286,12 +370,19 @@ static void compute_tangents(MeshData& mesh) {
 }
 
 
-Result<std::unique_ptr<Scene>> Scene::from_gltf(const std::string& file_name) {
+// Owns what a SceneData decoded from glTF points to
+struct DecodedGltf {
+    std::vector<MeshData> meshes;
+    std::vector<TextureData> textures;
+};
+
+Result<SceneData> SceneData::from_gltf(const std::string& file_name) {
     const double time = program_time();
-    DEFER(std::cout << file_name << " loaded in " << std::round((program_time() - time) * 100.0) / 100.0 << "s" << std::endl);
+    DEFER(std::cout << file_name << " decoded in " << std::round((program_time() - time) * 100.0) / 100.0 << "s" << std::endl);
 
     tinygltf::TinyGLTF ctx;
     tinygltf::Model gltf;
+    ctx.SetImageLoader(keep_image_encoded, nullptr);
 
     {
         std::string err;
@@ -316,10 +407,15 @@ Result<std::unique_ptr<Scene>> Scene::from_gltf(const std::string& file_name) {
 
     std::cout << file_name << " parsed in " << std::round((program_time() - time) * 100.0) / 100.0 << "s" << std::endl;
 
-    auto scene = std::make_unique<Scene>();
+    SceneData data;
+    const auto decoded = std::make_shared<DecodedGltf>();
 
-    std::unordered_map<int, std::shared_ptr<Texture>> textures;
-    std::unordered_map<int, std::shared_ptr<Material>> materials;
+    // Map glTF indices to indices in data. Textures first index images, the ones that decode are numbered afterwards.
+    std::unordered_map<int, int> textures;
+    std::vector<std::pair<int, bool>> images;
+    std::unordered_map<int, int> materials;
+    std::map<std::pair<int, size_t>, u32> meshes;
+    std::vector<const tinygltf::Primitive*> primitives;
     std::unordered_map<int, glm::mat4> node_transforms;
 
     {
@@ -353,73 +449,171 @@ Result<std::unique_ptr<Scene>> Scene::from_gltf(const std::string& file_name) {
                 continue;
             }
 
-            auto mesh = build_mesh_data(gltf, prim);
-            if(!mesh.is_ok) {
-                return {false, {}};
-            }
-
-            if(mesh.value.vertices[0].tangent_bitangent_sign == glm::vec4(0.0f)) {
-                compute_tangents(mesh.value);
+            // Nodes referencing the same mesh share its GPU buffers, so every primitive is only decoded once
+            const auto [mesh_it, inserted] = meshes.try_emplace({node.mesh, j}, u32(primitives.size()));
+            if(inserted) {
+                primitives.push_back(&prim);
             }
 
-            std::shared_ptr<Material> material;
+            int material = -1;
             if(prim.material >= 0) {
-                auto& mat = materials[prim.material];
-
-                if(!mat) {
+                const auto [mat_it, inserted] = materials.try_emplace(prim.material, int(data.materials.size()));
+                if(inserted) {
                     const auto& albedo_info = gltf.materials[prim.material].pbrMetallicRoughness.baseColorTexture;
                     const auto& normal_info = gltf.materials[prim.material].normalTexture;
 
-                    auto load_texture = [&](auto texture_info, bool as_sRGB) -> std::shared_ptr<Texture> {
+                    auto load_texture = [&](auto texture_info, bool as_sRGB) -> int {
                         if(texture_info.texCoord != 0) {
                             std::cerr << "Unsupported texture coordinate channel (" << texture_info.texCoord << ")" << std::endl;
-                            return nullptr;
+                            return -1;
                         }
 
                         if(texture_info.index < 0) {
-                            return nullptr;
+                            return -1;
                         }
 
                         const int index = gltf.textures[texture_info.index].source;
                         if(index < 0) {
-                            return nullptr;
+                            return -1;
                         }
 
-                        auto& texture = textures[index];
-                        if(!texture) {
-                            if(const auto r = build_texture_data(gltf.images[index], as_sRGB); r.is_ok) {
-                                texture = std::make_shared<Texture>(r.value);
-                            }
+                        // Images are decoded with the color space of their first use
+                        const auto [tex_it, inserted] = textures.try_emplace(index, int(images.size()));
+                        if(inserted) {
+                            images.emplace_back(index, as_sRGB);
                         }
-                        return texture;
+                        return tex_it->second;
                     };
 
-                    auto albedo = load_texture(albedo_info, true);
-                    auto normal = load_texture(normal_info, false);
-
-                    if(!albedo) {
-                        mat = Material::empty_material();
-                    } else if(!normal) {
-                        mat = std::make_shared<Material>(Material::textured_material());
-                        mat->set_texture(0u, albedo);
-                    } else {
-                        mat = std::make_shared<Material>(Material::textured_normal_mapped_material());
-                        mat->set_texture(0u, albedo);
-                        mat->set_texture(1u, normal);
-                    }
+                    MaterialData mat;
+                    mat.albedo = load_texture(albedo_info, true);
+                    mat.normal = load_texture(normal_info, false);
+                    data.materials.push_back(mat);
                 }
 
-                material = mat;
+                material = mat_it->second;
             }
 
-            auto scene_object = SceneObject(std::make_shared<StaticMesh>(mesh.value), std::move(material));
-            scene_object.set_transform(node_transform);
-            scene->add_object(std::move(scene_object));
+            data.objects.push_back(ObjectData{mesh_it->second, material, node_transform});
         }
     }
 
-    return {true, std::move(scene)};
+    // Images and primitives are independent: decode them (and optimize meshes) on every core.
+    // Images come first, as they usually take the longest.
+    std::atomic<bool> decoded_all = true;
+    decoded->meshes.resize(primitives.size());
+    std::vector<VertexCacheStats> stats_before(primitives.size());
+    std::vector<VertexCacheStats> stats_after(primitives.size());
+    std::vector<Result<TextureData>> image_data(images.size());
+    std::vector<double> image_times(images.size());
+    ThreadPool::global().parallel_for(images.size() + primitives.size(), 1, [&](size_t begin, size_t end) {
+        for(size_t task = begin; task != end; ++task) {
+            if(task < images.size()) {
+                const double image_start = program_time();
+                image_data[task] = build_texture_data(gltf.images[images[task].first], images[task].second);
+                image_times[task] = program_time() - image_start;
+                continue;
+            }
+
+            const size_t i = task - images.size();
+            auto mesh = build_mesh_data(gltf, *primitives[i]);
+            if(!mesh.is_ok) {
+                decoded_all = false;
+                continue;
+            }
+
+            if(mesh.value.vertices[0].tangent_bitangent_sign == glm::vec4(0.0f)) {
+                compute_tangents(mesh.value);
+            }
+
+            stats_before[i] = analyze_vertex_cache(mesh.value.indices, mesh.value.vertices.size());
+            optimize_mesh(mesh.value);
+            build_meshlets(mesh.value);
+            stats_after[i] = analyze_vertex_cache(mesh.value.indices, mesh.value.vertices.size());
+            generate_lods(mesh.value);
+
+            decoded->meshes[i] = std::move(mesh.value);
+        }
+    });
+
+    if(!decoded_all) {
+        return {false, {}};
+    }
+
+    {
+        // Materials lose the textures whose image failed to decode
+        std::vector<int> texture_indices(images.size(), -1);
+        for(size_t i = 0; i != images.size(); ++i) {
+            const tinygltf::Image& image = gltf.images[images[i].first];
+            std::cout << file_name << " image " << images[i].first << " (" << (image.name.empty() ? image.uri : image.name) << ")";
+            if(image_data[i].is_ok) {
+                const glm::uvec2 size = image_data[i].value.size;
+                std::cout << ": " << size.x << "x" << size.y << " decoded in " << std::round(image_times[i] * 100000.0) / 100.0 << "ms" << std::endl;
+                texture_indices[i] = int(decoded->textures.size());
+                decoded->textures.emplace_back(std::move(image_data[i].value));
+            } else {
+                std::cout << ": failed" << std::endl;
+            }
+        }
+        for(MaterialData& mat : data.materials) {
+            mat.albedo = mat.albedo < 0 ? -1 : texture_indices[mat.albedo];
+            mat.normal = mat.normal < 0 ? -1 : texture_indices[mat.normal];
+        }
+        std::cout << file_name << " decoded " << images.size() << " of " << gltf.images.size() << " images" << std::endl;
+    }
+
+    {
+        VertexCacheStats before;
+        VertexCacheStats after;
+        for(size_t i = 0; i != primitives.size(); ++i) {
+            before.add(stats_before[i]);
+            after.add(stats_after[i]);
+        }
+        std::cout << file_name << " vertex cache: ACMR " << before.acmr() << " -> " << after.acmr()
+                  << ", ATVR " << before.atvr() << " -> " << after.atvr()
+                  << ", " << before.vertex_count << " -> " << after.vertex_count << " vertices" << std::endl;
+
+        // Meshes with fewer LODs count with their coarsest one
+        std::array<size_t, max_mesh_lods> lod_triangles = {};
+        for(const MeshData& mesh : decoded->meshes) {
+            for(size_t lod = 0; lod != max_mesh_lods; ++lod) {
+                lod_triangles[lod] += mesh.lods.empty() ? mesh.indices.size() / 3 : mesh.lods[std::min(lod, mesh.lods.size() - 1)].index_count / 3;
+            }
+        }
+        std::cout << file_name << " LOD triangles:";
+        for(const size_t triangles : lod_triangles) {
+            std::cout << " " << triangles;
+        }
+        std::cout << std::endl;
+
+        size_t meshlet_count = 0;
+        for(const MeshData& mesh : decoded->meshes) {
+            meshlet_count += mesh.meshlets.size();
+        }
+        std::cout << file_name << " meshlets: " << meshlet_count << std::endl;
+    }
+
+    for(const MeshData& mesh : decoded->meshes) {
+        data.meshes.emplace_back(mesh);
+    }
+    for(const TextureData& texture : decoded->textures) {
+        const size_t bytes = image_byte_size(texture.format, texture.size.x, texture.size.y);
+        data.textures.push_back(TexturePayload{texture.size, texture.format, 1, Span<const u8>(texture.data.get(), bytes)});
+    }
+    data.storage = decoded;
+
+    return {true, std::move(data)};
 }
 
+Result<std::unique_ptr<Scene>> Scene::from_gltf(const std::string& file_name) {
+    SceneLoader loader(file_name);
+    loader.wait();
+    loader.update(std::numeric_limits<size_t>::max());
+
+    if(loader.state() != SceneLoader::State::Done) {
+        return {false, {}};
+    }
+    return {true, loader.take_scene()};
 }
 
+}
@@ -0,0 +1,175 @@
+#include "StateCache.h"
+
+#include <Material.h>
+#include <StaticMesh.h>
+
+#include <glad/glad.h>
+
+namespace OM3D {
+
+void StateCache::reset() {
+    _blend_mode.reset();
+    _depth_test_mode.reset();
+    _depth_write.reset();
+    _depth_locked = false;
+
+    _program = nullptr;
+    _textures = {};
+    _mesh_arena = nullptr;
+    _index_buffer = nullptr;
+    _positions_only.reset();
+    _vertex_format.reset();
+}
+
+bool StateCache::needs_change(bool changed) {
+    ++(changed ? _state_changes : _avoided_state_changes);
+    return changed;
+}
+
+void StateCache::set_blend_mode(BlendMode blend) {
+    if(!needs_change(_blend_mode != blend)) {
+        return;
+    }
+    _blend_mode = blend;
+
+    switch(blend) {
+        case BlendMode::None:
+            glDisable(GL_BLEND);
+            glEnable(GL_CULL_FACE);
+        break;
+
+        case BlendMode::Alpha:
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            glDisable(GL_CULL_FACE);
+        break;
+
+        case BlendMode::Additive:
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_ONE, GL_ONE);
+            glEnable(GL_CULL_FACE);
+        break;
+    }
+}
+
+void StateCache::set_depth_test_mode(DepthTestMode depth) {
+    if(_depth_locked) {
+        return;
+    }
+    if(!needs_change(_depth_test_mode != depth)) {
+        return;
+    }
+    _depth_test_mode = depth;
+
+    switch(depth) {
+        case DepthTestMode::None:
+            glDisable(GL_DEPTH_TEST);
+        break;
+
+        case DepthTestMode::Equal:
+            glEnable(GL_DEPTH_TEST);
+            glDepthFunc(GL_EQUAL);
+        break;
+
+        case DepthTestMode::Standard:
+            glEnable(GL_DEPTH_TEST);
+            // We are using reverse-Z
+            glDepthFunc(GL_GEQUAL);
+        break;
+
+        case DepthTestMode::Reversed:
+            glEnable(GL_DEPTH_TEST);
+            // We are using reverse-Z
+            glDepthFunc(GL_LEQUAL);
+        break;
+    }
+}
+
+void StateCache::set_depth_write(bool write) {
+    if(_depth_locked) {
+        return;
+    }
+    if(!needs_change(_depth_write != write)) {
+        return;
+    }
+    _depth_write = write;
+    glDepthMask(write);
+}
+
+void StateCache::lock_depth_state(DepthTestMode depth, bool write) {
+    _depth_locked = false;
+    set_depth_test_mode(depth);
+    set_depth_write(write);
+    _depth_locked = true;
+}
+
+void StateCache::unlock_depth_state() {
+    _depth_locked = false;
+}
+
+void StateCache::bind_program(const Program& program) {
+    if(!needs_change(_program != &program)) {
+        return;
+    }
+    _program = &program;
+    program.bind();
+}
+
+void StateCache::bind_texture(u32 index, const Texture& texture) {
+    if(index >= max_texture_units) {
+        needs_change(true);
+        texture.bind(index);
+        return;
+    }
+
+    if(!needs_change(_textures[index] != &texture)) {
+        return;
+    }
+    _textures[index] = &texture;
+    texture.bind(index);
+}
+
+void StateCache::bind_mesh_arena(const MeshArena& arena, bool positions_only, const ByteBuffer* index_buffer) {
+    if(needs_change(_positions_only != positions_only || _vertex_format != arena.vertex_format())) {
+        if(positions_only) {
+            StaticMesh::bind_position_format(arena.vertex_format());
+        } else {
+            StaticMesh::bind_vertex_format(arena.vertex_format());
+        }
+        _positions_only = positions_only;
+        _vertex_format = arena.vertex_format();
+        _mesh_arena = nullptr;
+    }
+
+    if(needs_change(_mesh_arena != &arena)) {
+        _mesh_arena = &arena;
+        _index_buffer = nullptr;
+        if(positions_only) {
+            arena.bind_positions();
+        } else {
+            arena.bind();
+        }
+    }
+
+    // Only tracked once an index buffer other than the arena's has been involved
+    if((index_buffer || _index_buffer) && needs_change(_index_buffer != index_buffer)) {
+        _index_buffer = index_buffer;
+        if(index_buffer) {
+            index_buffer->bind(BufferUsage::Index);
+        } else if(positions_only) {
+            arena.bind_positions();
+        } else {
+            arena.bind();
+        }
+    }
+}
+
+u32 StateCache::state_changes() const {
+    return _state_changes;
+}
+
+u32 StateCache::avoided_state_changes() const {
+    return _avoided_state_changes;
+}
+
+}
@@ -0,0 +1,68 @@
+#ifndef STATECACHE_H
+#define STATECACHE_H
+
+#include <graphics.h>
+
+#include <array>
+#include <optional>
+
+namespace OM3D {
+
+enum class BlendMode;
+enum class DepthTestMode;
+enum class VertexFormat;
+
+class Program;
+class Texture;
+class MeshArena;
+class ByteBuffer;
+
+// Tracks the GL state set through it, so that setting the same state again emits no GL call.
+// The cache can't see changes made behind its back: call reset() (or use a new cache) when starting a pass.
+class StateCache : NonCopyable {
+
+    public:
+        static constexpr u32 max_texture_units = 16;
+
+        void reset();
+
+        void set_blend_mode(BlendMode blend);
+        void set_depth_test_mode(DepthTestMode depth);
+        void set_depth_write(bool write);
+
+        // Sets the depth state and ignores depth changes until unlock_depth_state() (or reset()),
+        // so materials can be drawn with a depth state other than their own
+        void lock_depth_state(DepthTestMode depth, bool write);
+        void unlock_depth_state();
+
+        void bind_program(const Program& program);
+        void bind_texture(u32 index, const Texture& texture);
+        // Binds the arena and the matching vertex format, positions_only only binds the position stream.
+        // index_buffer replaces the arena's index buffer, when set.
+        void bind_mesh_arena(const MeshArena& arena, bool positions_only = false, const ByteBuffer* index_buffer = nullptr);
+
+        u32 state_changes() const;
+        u32 avoided_state_changes() const;
+
+    private:
+        bool needs_change(bool changed);
+
+        std::optional<BlendMode> _blend_mode;
+        std::optional<DepthTestMode> _depth_test_mode;
+        std::optional<bool> _depth_write;
+        bool _depth_locked = false;
+
+        const Program* _program = nullptr;
+        std::array<const Texture*, max_texture_units> _textures = {};
+        const MeshArena* _mesh_arena = nullptr;
+        const ByteBuffer* _index_buffer = nullptr;
+        std::optional<bool> _positions_only;
+        std::optional<VertexFormat> _vertex_format;
+
+        u32 _state_changes = 0;
+        u32 _avoided_state_changes = 0;
+};
+
+}
+
+#endif // STATECACHE_H
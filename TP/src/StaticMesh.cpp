@@ -1,14 +1,41 @@
 #include "StaticMesh.h"
 
+#include <StateCache.h>
+
 #include <glad/glad.h>
 
+#include <glm/geometric.hpp>
+
+#include <cstddef>
+
 namespace OM3D {
 
-StaticMesh::StaticMesh(const MeshData& data) :
-    _vertex_buffer(data.vertices),
-    _index_buffer(data.indices) {
-    glm::vec3 max(data.vertices.at(0).position);
-    glm::vec3 min(data.vertices.at(0).position);
+StaticMesh::StaticMesh(const MeshView& data, std::shared_ptr<MeshArena> arena) :
+    _arena(arena ? std::move(arena) : std::make_shared<MeshArena>()) {
+    const MeshRange range = _arena->add(data);
+
+    // The arena stores the indices of every LOD one after the other
+    _lods[0] = range;
+    if(!data.lods.is_empty()) {
+        ALWAYS_ASSERT(data.lods.size() <= max_mesh_lods, "Too many LODs");
+        _lod_count = u32(data.lods.size());
+
+        u32 first_index = range.first_index;
+        for(u32 i = 0; i != _lod_count; ++i) {
+            _lods[i] = range;
+            _lods[i].first_index = first_index;
+            _lods[i].index_count = data.lods[i].index_count;
+            // Meshlets only cover the full detail mesh
+            _lods[i].meshlet_count = i ? 0 : range.meshlet_count;
+            _lod_errors[i] = data.lods[i].error;
+            first_index += data.lods[i].index_count;
+        }
+        ALWAYS_ASSERT(first_index == range.first_index + range.index_count, "LODs do not cover the mesh indices");
+    }
+
+    ALWAYS_ASSERT(!data.vertices.is_empty(), "Mesh has no vertices");
+    glm::vec3 max(data.vertices[0].position);
+    glm::vec3 min(data.vertices[0].position);
 
     for (Vertex v : data.vertices)
     {
@@ -27,31 +54,102 @@ StaticMesh::StaticMesh(const MeshData& data) :
     }
     
     _bounding_center = min + (glm::vec3((max.x - min.x) / 2, (max.y - min.y) / 2, (max.z - min.z) / 2));
-    _bounding_radius = (max - _bounding_center).length();
+    _bounding_radius = glm::length(max - _bounding_center);
+    _bounding_box = AABB{min, max};
 }
 
-void StaticMesh::draw() const {
-    _vertex_buffer.bind(BufferUsage::Attribute);
-    _index_buffer.bind(BufferUsage::Index);
-
-    // Vertex position
-    glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(Vertex), nullptr);
-    // Vertex normal
-    glVertexAttribPointer(1, 3, GL_FLOAT, false, sizeof(Vertex), reinterpret_cast<void*>(3 * sizeof(float)));
-    // Vertex uv
-    glVertexAttribPointer(2, 2, GL_FLOAT, false, sizeof(Vertex), reinterpret_cast<void*>(6 * sizeof(float)));
-    // Tangent / bitangent sign
-    glVertexAttribPointer(3, 4, GL_FLOAT, false, sizeof(Vertex), reinterpret_cast<void*>(8 * sizeof(float)));
-    // Vertex color
-    glVertexAttribPointer(4, 3, GL_FLOAT, false, sizeof(Vertex), reinterpret_cast<void*>(12 * sizeof(float)));
+const glm::vec3& StaticMesh::bounding_center() const {
+    return _bounding_center;
+}
 
+float StaticMesh::bounding_radius() const {
+    return _bounding_radius;
+}
+
+const AABB& StaticMesh::bounding_box() const {
+    return _bounding_box;
+}
+
+void StaticMesh::bind_position_format(VertexFormat format) {
+    if(format == VertexFormat::Compact) {
+        glVertexAttribFormat(0, 4, GL_UNSIGNED_SHORT, true, 0);
+    } else {
+        glVertexAttribFormat(0, 3, GL_FLOAT, false, 0);
+    }
+    glVertexAttribBinding(0, 1);
     glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
-    glEnableVertexAttribArray(2);
-    glEnableVertexAttribArray(3);
-    glEnableVertexAttribArray(4);
 
-    glDrawElements(GL_TRIANGLES, int(_index_buffer.element_count()), GL_UNSIGNED_INT, nullptr);
+    for(u32 i = 1; i != 5; ++i) {
+        glDisableVertexAttribArray(i);
+    }
+}
+
+void StaticMesh::bind_vertex_format(VertexFormat format) {
+    if(format == VertexFormat::Compact) {
+        glVertexAttribFormat(0, 4, GL_UNSIGNED_SHORT, true, offsetof(CompactVertex, position));
+        glVertexAttribFormat(1, 2, GL_SHORT, true, offsetof(CompactVertex, normal));
+        glVertexAttribFormat(2, 2, GL_HALF_FLOAT, false, offsetof(CompactVertex, uv));
+        glVertexAttribFormat(3, 2, GL_SHORT, true, offsetof(CompactVertex, tangent));
+        glVertexAttribFormat(4, 4, GL_UNSIGNED_BYTE, true, offsetof(CompactVertex, color));
+    } else {
+        // Vertex position
+        glVertexAttribFormat(0, 3, GL_FLOAT, false, 0);
+        // Vertex normal
+        glVertexAttribFormat(1, 3, GL_FLOAT, false, 3 * sizeof(float));
+        // Vertex uv
+        glVertexAttribFormat(2, 2, GL_FLOAT, false, 6 * sizeof(float));
+        // Tangent / bitangent sign
+        glVertexAttribFormat(3, 4, GL_FLOAT, false, 8 * sizeof(float));
+        // Vertex color
+        glVertexAttribFormat(4, 3, GL_FLOAT, false, 12 * sizeof(float));
+    }
+
+    for(u32 i = 0; i != 5; ++i) {
+        glVertexAttribBinding(i, 0);
+        glEnableVertexAttribArray(i);
+    }
+}
+
+void StaticMesh::bind() const {
+    _arena->bind();
+}
+
+size_t StaticMesh::index_count() const {
+    return _lods[0].index_count;
+}
+
+const MeshArena& StaticMesh::arena() const {
+    return *_arena;
+}
+
+const MeshRange& StaticMesh::range(u32 lod) const {
+    DEBUG_ASSERT(lod < _lod_count);
+    return _lods[lod];
+}
+
+u32 StaticMesh::lod_count() const {
+    return _lod_count;
+}
+
+float StaticMesh::lod_error(u32 lod) const {
+    DEBUG_ASSERT(lod < _lod_count);
+    return _lod_errors[lod];
+}
+
+void StaticMesh::draw() const {
+    const MeshRange& range = _lods[0];
+    bind_vertex_format(_arena->vertex_format());
+    bind();
+    glDrawElementsBaseVertex(GL_TRIANGLES, int(range.index_count), GL_UNSIGNED_INT, reinterpret_cast<void*>(range.first_index * sizeof(u32)), int(range.base_vertex));
+}
+
+void StaticMesh::draw(StateCache& cache, u32 instance_count, bool positions_only, u32 lod) const {
+    if(!instance_count) {
+        return;
+    }
+    const MeshRange& range = this->range(lod);
+    cache.bind_mesh_arena(*_arena, positions_only);
+    glDrawElementsInstancedBaseVertex(GL_TRIANGLES, int(range.index_count), GL_UNSIGNED_INT, reinterpret_cast<void*>(range.first_index * sizeof(u32)), int(instance_count), int(range.base_vertex));
 }
 
 }
@@ -2,17 +2,15 @@
 #define STATICMESH_H
 
 #include <graphics.h>
-#include <TypedBuffer.h>
-#include <Vertex.h>
+#include <MeshArena.h>
+#include <AABB.h>
 
-#include <vector>
+#include <array>
+#include <memory>
 
 namespace OM3D {
 
-struct MeshData {
-    std::vector<Vertex> vertices;
-    std::vector<u32> indices;
-};
+class StateCache;
 
 class StaticMesh : NonCopyable {
 
@@ -21,15 +19,43 @@ class StaticMesh : NonCopyable {
         StaticMesh(StaticMesh&&) = default;
         StaticMesh& operator=(StaticMesh&&) = default;
 
-        StaticMesh(const MeshData& data);
+        // Meshes built without an arena get one of their own
+        StaticMesh(const MeshView& data, std::shared_ptr<MeshArena> arena = nullptr);
 
         void draw() const;
+        void draw(StateCache& cache, u32 instance_count = 1, bool positions_only = false, u32 lod = 0) const;
+
+        // Vertex attribute layout is shared by all meshes of a format: it only needs to be set once per pass
+        static void bind_vertex_format(VertexFormat format = VertexFormat::Standard);
+        // Only enables the position attribute, read from the arena's position stream at binding 1
+        static void bind_position_format(VertexFormat format = VertexFormat::Standard);
+        void bind() const;
+
+        size_t index_count() const;
+
+        const MeshArena& arena() const;
+        // Location of the given LOD in the arena, LOD 0 being the full detail mesh
+        const MeshRange& range(u32 lod = 0) const;
+
+        u32 lod_count() const;
+        // Simplification error of the given LOD, relative to the bounding radius
+        float lod_error(u32 lod) const;
+
+        const glm::vec3& bounding_center() const;
+        float bounding_radius() const;
+        const AABB& bounding_box() const;
 
     private:
-        glm::vec3 _bounding_center;
-        float _bounding_radius;
-        TypedBuffer<Vertex> _vertex_buffer;
-        TypedBuffer<u32> _index_buffer;
+        glm::vec3 _bounding_center = {};
+        float _bounding_radius = 0.0f;
+        AABB _bounding_box;
+
+        std::shared_ptr<MeshArena> _arena;
+
+        // LODs only differ by their indices
+        std::array<MeshRange, max_mesh_lods> _lods = {};
+        std::array<float, max_mesh_lods> _lod_errors = {};
+        u32 _lod_count = 1;
 };
 
 }
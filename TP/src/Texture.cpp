@@ -2,6 +2,8 @@
 
 #include <glad/glad.h>
 
+#include <glm/common.hpp>
+
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
 
@@ -50,13 +52,37 @@ Texture::Texture(const TextureData& data) :
     glGenerateTextureMipmap(_handle.get());
 }
 
-Texture::Texture(const glm::uvec2 &size, ImageFormat format) :
+Texture::Texture(const glm::uvec2& size, ImageFormat format, Span<const u8> mips, u32 mip_count) :
     _handle(create_texture_handle()),
     _size(size),
     _format(format) {
 
     const ImageFormatGL gl_format = image_format_to_gl(_format);
-    glTextureStorage2D(_handle.get(), 1, gl_format.internal_format, _size.x, _size.y);
+    const u32 level_count = mip_count == 1 ? mip_levels(_size) : mip_count;
+    ALWAYS_ASSERT(level_count == mip_count || !is_block_compressed(_format), "Mips of block compressed textures can't be generated");
+    glTextureStorage2D(_handle.get(), level_count, gl_format.internal_format, _size.x, _size.y);
+
+    size_t offset = 0;
+    for(u32 level = 0; level != mip_count; ++level) {
+        const glm::uvec2 level_size = glm::max(glm::uvec2(1), _size >> level);
+        const size_t level_bytes = image_byte_size(_format, level_size.x, level_size.y);
+        ALWAYS_ASSERT(offset + level_bytes <= mips.size(), "Not enough data for mip chain");
+        upload_level(level, mips.data() + offset);
+        offset += level_bytes;
+    }
+
+    if(level_count != mip_count) {
+        glGenerateTextureMipmap(_handle.get());
+    }
+}
+
+Texture::Texture(const glm::uvec2 &size, ImageFormat format, u32 mip_count) :
+    _handle(create_texture_handle()),
+    _size(size),
+    _format(format) {
+
+    const ImageFormatGL gl_format = image_format_to_gl(_format);
+    glTextureStorage2D(_handle.get(), mip_count, gl_format.internal_format, _size.x, _size.y);
 }
 
 Texture::~Texture() {
@@ -65,18 +91,37 @@ Texture::~Texture() {
     }
 }
 
+void Texture::upload_level(u32 level, const u8* data) {
+    const glm::uvec2 level_size = glm::max(glm::uvec2(1), _size >> level);
+    const ImageFormatGL gl_format = image_format_to_gl(_format);
+    if(is_block_compressed(_format)) {
+        const size_t bytes = image_byte_size(_format, level_size.x, level_size.y);
+        glCompressedTextureSubImage2D(_handle.get(), level, 0, 0, level_size.x, level_size.y, gl_format.internal_format, GLsizei(bytes), data);
+    } else {
+        glTextureSubImage2D(_handle.get(), level, 0, 0, level_size.x, level_size.y, gl_format.format, gl_format.component_type, data);
+    }
+}
+
 void Texture::bind(u32 index) const {
     glBindTextureUnit(index, _handle.get());
 }
 
-void Texture::bind_as_image(u32 index, AccessType access) {
-    glBindImageTexture(index, _handle.get(), 0, false, 0, access_type_to_gl(access), image_format_to_gl(_format).internal_format);
+u64 Texture::bindless_handle() const {
+    return resident_texture_handle(_handle.get());
+}
+
+void Texture::bind_as_image(u32 index, AccessType access, u32 mip_level) {
+    glBindImageTexture(index, _handle.get(), mip_level, false, 0, access_type_to_gl(access), image_format_to_gl(_format).internal_format);
 }
 
 const glm::uvec2& Texture::size() const {
     return _size;
 }
 
+ImageFormat Texture::format() const {
+    return _format;
+}
+
 // Return number of mip levels needed
 u32 Texture::mip_levels(glm::uvec2 size) {
     const float side = float(std::max(size.x, size.y));
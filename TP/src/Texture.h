@@ -30,17 +30,29 @@ class Texture {
         ~Texture();
 
         Texture(const TextureData& data);
-        Texture(const glm::uvec2 &size, ImageFormat format);
+        // Uploads mip_count levels stored one after the other, from the largest.
+        // With a single level, the rest of the mip chain is generated, which block compressed formats don't support.
+        Texture(const glm::uvec2& size, ImageFormat format, Span<const u8> mips, u32 mip_count);
+        Texture(const glm::uvec2 &size, ImageFormat format, u32 mip_count = 1);
 
         void bind(u32 index) const;
-        void bind_as_image(u32 index, AccessType access);
+        void bind_as_image(u32 index, AccessType access, u32 mip_level = 0);
+
+        // Resident bindless handle, requires has_bindless_textures().
+        // The sampler state can't change afterwards. Reallocated textures (see TextureStreamer) get a new handle.
+        u64 bindless_handle() const;
 
         const glm::uvec2& size() const;
+        ImageFormat format() const;
 
         static u32 mip_levels(glm::uvec2 size);
 
     private:
         friend class Framebuffer;
+        friend class TextureStreamer;
+
+        // Uploads a whole level, of image_byte_size() bytes
+        void upload_level(u32 level, const u8* data);
 
         GLHandle _handle;
         glm::uvec2 _size = {};
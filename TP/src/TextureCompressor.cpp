@@ -0,0 +1,102 @@
+#include "TextureCompressor.h"
+
+#include <ThreadPool.h>
+
+#include <algorithm>
+#include <cstring>
+
+#define STB_DXT_IMPLEMENTATION
+#include <stb/stb_dxt.h>
+
+namespace OM3D {
+
+static u32 channel_count(ImageFormat format) {
+    switch(format) {
+        case ImageFormat::RGBA8_UNORM:
+        case ImageFormat::RGBA8_sRGB:
+            return 4;
+
+        case ImageFormat::RGB8_UNORM:
+        case ImageFormat::RGB8_sRGB:
+            return 3;
+
+        default:
+            return 0;
+    }
+}
+
+Result<ImageFormat> block_compressed_format(ImageFormat format, const glm::uvec2& size, Span<const u8> pixels, bool normal_map) {
+    const u32 channels = channel_count(format);
+    if(!channels || size.x % 4 || size.y % 4) {
+        return {false, {}};
+    }
+
+    if(normal_map) {
+        return {true, ImageFormat::BC5_UNORM};
+    }
+
+    const bool is_sRGB = format == ImageFormat::RGBA8_sRGB || format == ImageFormat::RGB8_sRGB;
+    bool transparent = false;
+    if(channels == 4) {
+        for(size_t i = 3; i < pixels.size() && !transparent; i += 4) {
+            transparent = pixels[i] != 255;
+        }
+    }
+
+    if(transparent) {
+        return {true, is_sRGB ? ImageFormat::BC3_sRGB : ImageFormat::BC3_UNORM};
+    }
+    return {true, is_sRGB ? ImageFormat::BC1_sRGB : ImageFormat::BC1_UNORM};
+}
+
+void compress_image(ImageFormat format, const glm::uvec2& size, Span<const u8> pixels, ImageFormat dst_format, u8* dst) {
+    const u32 channels = channel_count(format);
+    ALWAYS_ASSERT(channels, "Only 8 bits RGB and RGBA images can be block compressed");
+    ALWAYS_ASSERT(pixels.size() >= size_t(size.x) * size.y * channels, "Not enough data for image");
+
+    const u32 blocks_x = (size.x + 3) / 4;
+    const u32 blocks_y = (size.y + 3) / 4;
+    const size_t block_bytes = image_byte_size(dst_format, 4, 4);
+
+    ThreadPool::global().parallel_for(blocks_y, 16, [&](size_t begin, size_t end) {
+        for(size_t by = begin; by != end; ++by) {
+            for(u32 bx = 0; bx != blocks_x; ++bx) {
+                // Blocks past the edge of images smaller than a block repeat the last texels
+                u8 rgba[16 * 4] = {};
+                u8 rg[16 * 2] = {};
+                for(u32 i = 0; i != 16; ++i) {
+                    const u32 x = std::min(bx * 4 + i % 4, size.x - 1);
+                    const u32 y = std::min(u32(by) * 4 + i / 4, size.y - 1);
+                    const u8* texel = pixels.data() + (size_t(y) * size.x + x) * channels;
+                    for(u32 c = 0; c != 4; ++c) {
+                        rgba[i * 4 + c] = c < channels ? texel[c] : 255;
+                    }
+                    rg[i * 2] = texel[0];
+                    rg[i * 2 + 1] = texel[1];
+                }
+
+                u8* block = dst + (by * blocks_x + bx) * block_bytes;
+                switch(dst_format) {
+                    case ImageFormat::BC1_UNORM:
+                    case ImageFormat::BC1_sRGB:
+                        stb_compress_dxt_block(block, rgba, 0, STB_DXT_HIGHQUAL);
+                    break;
+
+                    case ImageFormat::BC3_UNORM:
+                    case ImageFormat::BC3_sRGB:
+                        stb_compress_dxt_block(block, rgba, 1, STB_DXT_HIGHQUAL);
+                    break;
+
+                    case ImageFormat::BC5_UNORM:
+                        stb_compress_bc5_block(block, rg);
+                    break;
+
+                    default:
+                        FATAL("Unsupported block compressed format");
+                }
+            }
+        }
+    });
+}
+
+}
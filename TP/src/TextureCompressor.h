@@ -0,0 +1,21 @@
+#ifndef TEXTURECOMPRESSOR_H
+#define TEXTURECOMPRESSOR_H
+
+#include <ImageFormat.h>
+
+#include <glm/vec2.hpp>
+
+namespace OM3D {
+
+// Block compressed format for an 8 bits RGB or RGBA image: BC5 for normal maps (only red and green are kept),
+// BC3 for images with transparent texels and BC1 otherwise, in the color space of the source.
+// Fails for other formats, and for sizes that are not a multiple of the block size.
+Result<ImageFormat> block_compressed_format(ImageFormat format, const glm::uvec2& size, Span<const u8> pixels, bool normal_map);
+
+// Encodes an 8 bits RGB or RGBA image, of any size, into one of the formats above.
+// dst must hold image_byte_size(dst_format, size.x, size.y) bytes. Block rows are encoded in parallel.
+void compress_image(ImageFormat format, const glm::uvec2& size, Span<const u8> pixels, ImageFormat dst_format, u8* dst);
+
+}
+
+#endif // TEXTURECOMPRESSOR_H
@@ -0,0 +1,209 @@
+#include "TextureStreamer.h"
+
+#include <glad/glad.h>
+
+#include <glm/common.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace OM3D {
+
+static glm::uvec2 level_size(const glm::uvec2& size, u32 level) {
+    return glm::max(glm::uvec2(1), size >> level);
+}
+
+static u64 level_bytes(const glm::uvec2& size, ImageFormat format, u32 level) {
+    const glm::uvec2 s = level_size(size, level);
+    return u64(image_byte_size(format, s.x, s.y));
+}
+
+// Bytes of levels [first, last)
+static u64 levels_bytes(const glm::uvec2& size, ImageFormat format, u32 first, u32 last) {
+    u64 bytes = 0;
+    for(u32 level = first; level < last; ++level) {
+        bytes += level_bytes(size, format, level);
+    }
+    return bytes;
+}
+
+// Largest level that fits in the mip tail
+static u32 tail_mip(const glm::uvec2& size, u32 mip_count) {
+    u32 mip = 0;
+    while(mip + 1 < mip_count && std::max(size.x, size.y) >> mip > TextureStreamer::tail_size) {
+        ++mip;
+    }
+    return mip;
+}
+
+u64 TextureStreamer::initial_bytes(const glm::uvec2& size, ImageFormat format, u32 mip_count) {
+    if(mip_count == 1) {
+        return level_bytes(size, format, 0);
+    }
+    return levels_bytes(size, format, tail_mip(size, mip_count), mip_count);
+}
+
+std::shared_ptr<Texture> TextureStreamer::add(const glm::uvec2& size, ImageFormat format, Span<const u8> mips, u32 mip_count, std::shared_ptr<const void> storage) {
+    StreamedTexture streamed;
+    streamed.size = size;
+    streamed.format = format;
+
+    if(mip_count == 1) {
+        streamed.texture = std::make_shared<Texture>(size, format, mips, mip_count);
+        streamed.mip_count = Texture::mip_levels(size);
+    } else {
+        ALWAYS_ASSERT(levels_bytes(size, format, 0, mip_count) <= mips.size(), "Not enough data for mip chain");
+        streamed.texture = std::make_shared<Texture>();
+        streamed.mip_count = mip_count;
+        streamed.mips = mips;
+        streamed.storage = std::move(storage);
+        streamed.tail_mip = tail_mip(size, mip_count);
+        streamed.resident_mip = mip_count;
+        set_resident_mip(streamed, streamed.tail_mip);
+    }
+
+    streamed.wanted_mip = streamed.tail_mip;
+    _stats.resident_bytes += levels_bytes(size, format, streamed.resident_mip, streamed.mip_count);
+
+    _indices[streamed.texture.get()] = u32(_textures.size());
+    _textures.emplace_back(std::move(streamed));
+    return _textures.back().texture;
+}
+
+void TextureStreamer::request(const Texture* texture, float screen_size) {
+    const auto it = _indices.find(texture);
+    if(it == _indices.end()) {
+        return;
+    }
+
+    StreamedTexture& streamed = _textures[it->second];
+    if(streamed.last_used_frame != _frame) {
+        streamed.last_used_frame = _frame;
+        streamed.wanted_mip = streamed.tail_mip;
+    }
+
+    // Level with about one texel per pixel
+    const float side = float(std::max(streamed.size.x, streamed.size.y));
+    const float mip = screen_size > 0.0f ? std::max(0.0f, std::floor(std::log2(side / screen_size))) : float(streamed.tail_mip);
+    streamed.wanted_mip = std::min(streamed.wanted_mip, std::min(u32(mip), streamed.tail_mip));
+}
+
+void TextureStreamer::update(u64 budget_bytes, double max_upload_time) {
+    const double start = program_time();
+    _stats.uploaded_levels = 0;
+    _stats.evicted_levels = 0;
+
+    std::vector<u32> pending;
+    for(u32 i = 0; i != _textures.size(); ++i) {
+        StreamedTexture& texture = _textures[i];
+        if(texture.last_used_frame != _frame) {
+            texture.wanted_mip = texture.tail_mip;
+        }
+        if(texture.resident_mip > texture.wanted_mip) {
+            pending.push_back(i);
+        }
+    }
+
+    // Textures furthest from what they need first
+    std::sort(pending.begin(), pending.end(), [&](u32 a, u32 b) {
+        const StreamedTexture& ta = _textures[a];
+        const StreamedTexture& tb = _textures[b];
+        return ta.resident_mip - ta.wanted_mip > tb.resident_mip - tb.wanted_mip;
+    });
+
+    for(const u32 index : pending) {
+        if(_stats.uploaded_levels && program_time() - start >= max_upload_time) {
+            break;
+        }
+
+        StreamedTexture& texture = _textures[index];
+        const u32 mip = texture.resident_mip - 1;
+        const u64 bytes = level_bytes(texture.size, texture.format, mip);
+        if(!make_room(bytes, budget_bytes, &texture)) {
+            break;
+        }
+
+        set_resident_mip(texture, mip);
+        _stats.resident_bytes += bytes;
+        ++_stats.uploaded_levels;
+    }
+
+    // The budget may have shrunk
+    make_room(0, budget_bytes, nullptr);
+
+    _stats.upload_time = program_time() - start;
+    ++_frame;
+}
+
+bool TextureStreamer::make_room(u64 bytes, u64 budget_bytes, const StreamedTexture* keep) {
+    if(_stats.resident_bytes + bytes <= budget_bytes) {
+        return true;
+    }
+
+    std::vector<u32> evictable;
+    for(u32 i = 0; i != _textures.size(); ++i) {
+        if(&_textures[i] != keep && _textures[i].resident_mip < _textures[i].wanted_mip) {
+            evictable.push_back(i);
+        }
+    }
+    std::sort(evictable.begin(), evictable.end(), [&](u32 a, u32 b) {
+        return _textures[a].last_used_frame < _textures[b].last_used_frame;
+    });
+
+    for(const u32 index : evictable) {
+        StreamedTexture& texture = _textures[index];
+        _stats.resident_bytes -= levels_bytes(texture.size, texture.format, texture.resident_mip, texture.wanted_mip);
+        _stats.evicted_levels += texture.wanted_mip - texture.resident_mip;
+        set_resident_mip(texture, texture.wanted_mip);
+
+        if(_stats.resident_bytes + bytes <= budget_bytes) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void TextureStreamer::set_resident_mip(StreamedTexture& streamed, u32 mip) {
+    Texture texture(level_size(streamed.size, mip), streamed.format, streamed.mip_count - mip);
+
+    u64 offset = levels_bytes(streamed.size, streamed.format, 0, mip);
+    for(u32 level = mip; level != streamed.mip_count; ++level) {
+        const glm::uvec2 size = level_size(streamed.size, level);
+        if(level >= streamed.resident_mip) {
+            glCopyImageSubData(streamed.texture->_handle.get(), GL_TEXTURE_2D, level - streamed.resident_mip, 0, 0, 0,
+                               texture._handle.get(), GL_TEXTURE_2D, level - mip, 0, 0, 0,
+                               size.x, size.y, 1);
+        } else {
+            texture.upload_level(level - mip, streamed.mips.data() + offset);
+        }
+        offset += level_bytes(streamed.size, streamed.format, level);
+    }
+
+    // Materials hold the same Texture, which now samples the new levels
+    *streamed.texture = std::move(texture);
+    streamed.resident_mip = mip;
+}
+
+const TextureStreamer::Stats& TextureStreamer::stats() const {
+    return _stats;
+}
+
+std::vector<TextureStreamer::TextureInfo> TextureStreamer::texture_infos() const {
+    std::vector<TextureInfo> infos;
+    infos.reserve(_textures.size());
+    for(const StreamedTexture& texture : _textures) {
+        TextureInfo info;
+        info.size = texture.size;
+        info.format = texture.format;
+        info.mip_count = texture.mip_count;
+        info.resident_mip = texture.resident_mip;
+        info.wanted_mip = texture.wanted_mip;
+        info.resident_bytes = levels_bytes(texture.size, texture.format, texture.resident_mip, texture.mip_count);
+        info.streamed = !texture.mips.is_empty();
+        infos.push_back(info);
+    }
+    return infos;
+}
+
+}
@@ -0,0 +1,87 @@
+#ifndef TEXTURESTREAMER_H
+#define TEXTURESTREAMER_H
+
+#include <Texture.h>
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace OM3D {
+
+// Keeps the mips of textures resident on the GPU according to on screen demand.
+// Textures are created with their mip tail only. Each frame, request() records how many pixels
+// textures cover on screen, and update() raises the residency of the ones that need more detail, one level at a time.
+// Only the levels from the resident mip down to the smallest are allocated: changing residency reallocates
+// the texture in place (the shared Texture is kept) and copies the levels it keeps on the GPU.
+// When over budget, levels that are not needed anymore are evicted, least recently used first.
+class TextureStreamer : NonMovable {
+
+    public:
+        // Largest side of the mip tail, resident from the start and never evicted
+        static constexpr u32 tail_size = 64;
+
+        struct Stats {
+            u64 resident_bytes = 0;
+            u32 uploaded_levels = 0;
+            u32 evicted_levels = 0;
+            double upload_time = 0.0;
+        };
+
+        struct TextureInfo {
+            glm::uvec2 size = {};
+            ImageFormat format = ImageFormat::RGBA8_UNORM;
+            u32 mip_count = 1;
+            // Largest mip resident, and largest one requested this frame
+            u32 resident_mip = 0;
+            u32 wanted_mip = 0;
+            u64 resident_bytes = 0;
+            bool streamed = false;
+        };
+
+        // mips holds mip_count levels one after the other, from the largest, and must stay valid as long as storage is alive.
+        // Textures with a single level can't be streamed: they are uploaded whole, with mips generated on the GPU.
+        std::shared_ptr<Texture> add(const glm::uvec2& size, ImageFormat format, Span<const u8> mips, u32 mip_count, std::shared_ptr<const void> storage);
+
+        // Bytes uploaded by add()
+        static u64 initial_bytes(const glm::uvec2& size, ImageFormat format, u32 mip_count);
+
+        // Call once per frame for every visible use of a texture, before update()
+        void request(const Texture* texture, float screen_size);
+
+        // Uploads requested levels for at most max_upload_time seconds (at least one level), then clears requests
+        void update(u64 budget_bytes, double max_upload_time);
+
+        const Stats& stats() const;
+        std::vector<TextureInfo> texture_infos() const;
+
+    private:
+        struct StreamedTexture {
+            std::shared_ptr<Texture> texture;
+            glm::uvec2 size = {};
+            ImageFormat format = ImageFormat::RGBA8_UNORM;
+            u32 mip_count = 1;
+            Span<const u8> mips;
+            std::shared_ptr<const void> storage;
+
+            u32 tail_mip = 0;
+            u32 resident_mip = 0;
+            u32 wanted_mip = 0;
+            u64 last_used_frame = 0;
+        };
+
+        // Reallocates the texture with levels [mip, mip_count), copying the resident ones and uploading the others
+        void set_resident_mip(StreamedTexture& texture, u32 mip);
+        // Evicts unneeded levels, least recently used first, until bytes more fit in the budget
+        bool make_room(u64 bytes, u64 budget_bytes, const StreamedTexture* keep);
+
+        std::vector<StreamedTexture> _textures;
+        std::unordered_map<const Texture*, u32> _indices;
+
+        u64 _frame = 1;
+        Stats _stats;
+};
+
+}
+
+#endif // TEXTURESTREAMER_H
@@ -0,0 +1,113 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace OM3D {
+
+ThreadPool::ThreadPool(u32 thread_count) {
+    for(u32 i = 0; i != thread_count; ++i) {
+        _threads.emplace_back([this] { worker(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::unique_lock lock(_lock);
+        _stop = true;
+    }
+    _condition.notify_all();
+
+    for(std::thread& thread : _threads) {
+        thread.join();
+    }
+}
+
+u32 ThreadPool::thread_count() const {
+    return u32(_threads.size());
+}
+
+void ThreadPool::schedule(std::function<void()> task) {
+    {
+        std::unique_lock lock(_lock);
+        _tasks.emplace_back(std::move(task));
+    }
+    _condition.notify_one();
+}
+
+void ThreadPool::parallel_for(size_t count, size_t chunk_size, const std::function<void(size_t, size_t)>& func) {
+    DEBUG_ASSERT(chunk_size);
+
+    const size_t chunk_count = (count + chunk_size - 1) / chunk_size;
+    if(chunk_count <= 1 || _threads.empty()) {
+        if(count) {
+            func(0, count);
+        }
+        return;
+    }
+
+    struct Job {
+        std::atomic<size_t> next_chunk = 0;
+        size_t done_chunks = 0;
+        std::mutex lock;
+        std::condition_variable condition;
+    };
+
+    // Helpers can start after every chunk is done: they only touch the shared job in that case, never func
+    const auto job = std::make_shared<Job>();
+    auto run_chunks = [=, &func] {
+        for(;;) {
+            const size_t chunk = job->next_chunk++;
+            if(chunk >= chunk_count) {
+                break;
+            }
+
+            const size_t begin = chunk * chunk_size;
+            func(begin, std::min(count, begin + chunk_size));
+
+            std::unique_lock lock(job->lock);
+            if(++job->done_chunks == chunk_count) {
+                job->condition.notify_all();
+            }
+        }
+    };
+
+    const size_t helpers = std::min(size_t(thread_count()), chunk_count - 1);
+    for(size_t i = 0; i != helpers; ++i) {
+        schedule(run_chunks);
+    }
+
+    run_chunks();
+
+    std::unique_lock lock(job->lock);
+    job->condition.wait(lock, [&] { return job->done_chunks == chunk_count; });
+}
+
+u32 ThreadPool::default_thread_count() {
+    const u32 hardware_threads = std::thread::hardware_concurrency();
+    return std::max(hardware_threads, 2u) - 1;
+}
+
+ThreadPool& ThreadPool::global() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::worker() {
+    for(;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(_lock);
+            _condition.wait(lock, [&] { return _stop || !_tasks.empty(); });
+            if(_tasks.empty()) {
+                return;
+            }
+            task = std::move(_tasks.front());
+            _tasks.pop_front();
+        }
+        task();
+    }
+}
+
+}
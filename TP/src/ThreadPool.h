@@ -0,0 +1,45 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <utils.h>
+
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+
+namespace OM3D {
+
+class ThreadPool : NonMovable {
+
+    public:
+        ThreadPool(u32 thread_count = default_thread_count());
+        ~ThreadPool();
+
+        u32 thread_count() const;
+
+        void schedule(std::function<void()> task);
+
+        // Calls func(begin, end) on chunks of [0; count), using the calling thread as well.
+        // Returns once every chunk has been processed.
+        void parallel_for(size_t count, size_t chunk_size, const std::function<void(size_t, size_t)>& func);
+
+        static u32 default_thread_count();
+        static ThreadPool& global();
+
+    private:
+        void worker();
+
+        std::vector<std::thread> _threads;
+
+        std::deque<std::function<void()>> _tasks;
+        std::mutex _lock;
+        std::condition_variable _condition;
+        bool _stop = false;
+};
+
+}
+
+#endif // THREADPOOL_H
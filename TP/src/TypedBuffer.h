@@ -26,6 +26,11 @@ class TypedBuffer : public ByteBuffer {
         BufferMapping<T> map(AccessType access = AccessType::ReadWrite) {
             return BufferMapping<T>(ByteBuffer::map_internal(access), byte_size(), handle());
         }
+
+        // Maps count elements from first for writing, their previous content is discarded
+        BufferMapping<T> map_range(size_t first, size_t count) {
+            return BufferMapping<T>(ByteBuffer::map_range_internal(first * sizeof(T), count * sizeof(T)), count * sizeof(T), handle());
+        }
 };
 
 }
@@ -4,6 +4,7 @@
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 #include <glm/vec4.hpp>
+#include <glm/gtc/type_precision.hpp>
 
 namespace OM3D {
 
@@ -15,6 +16,22 @@ struct Vertex {
     glm::vec3 color = glm::vec3(1.0f, 1.0f, 1.0f); // to avoid completly black meshes if no color is present
 };
 
+enum class VertexFormat {
+    Standard,
+    // CompactVertex, decoded in the vertex shader when COMPACT_VERTICES is defined
+    Compact,
+};
+
+struct CompactVertex {
+    glm::u16vec4 position;  // unorm, relative to the mesh bounding box. w is the bitangent sign (0 or 65535, read as 0 or 1)
+    glm::i16vec2 normal;    // snorm, octahedral
+    glm::i16vec2 tangent;   // snorm, octahedral
+    glm::u16vec2 uv;        // half
+    glm::u8vec4 color;      // unorm
+};
+
+static_assert(sizeof(CompactVertex) == 24);
+
 }
 
 #endif // VERTEX_H
@@ -22,4 +22,15 @@
 #define OS_LINUX
 #endif
 
+
+/****************** SIMD DEFINES BELOW ******************/
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_SSE
+#endif
+
+#if defined(__AVX__)
+#define SIMD_AVX
+#endif
+
 #endif // DEFINES_H
@@ -35,6 +35,9 @@ u32 buffer_usage_to_gl(BufferUsage usage) {
 
         case BufferUsage::Storage:
             return GL_SHADER_STORAGE_BUFFER;
+
+        case BufferUsage::Indirect:
+            return GL_DRAW_INDIRECT_BUFFER;
     }
 
     FATAL("Unknown usage value");
@@ -65,10 +68,39 @@ u32 align_up_to(u32 val, u32 up_to) {
 
 static GLuint global_vao = 0;
 
+// GL_ARB_bindless_texture entry points, null when unsupported
+static GLuint64 (APIENTRYP get_texture_handle)(GLuint) = nullptr;
+static void (APIENTRYP make_texture_handle_resident)(GLuint64) = nullptr;
+static GLboolean (APIENTRYP is_texture_handle_resident)(GLuint64) = nullptr;
+
+bool has_bindless_textures() {
+    return get_texture_handle;
+}
+
+u64 resident_texture_handle(u32 texture) {
+    ALWAYS_ASSERT(has_bindless_textures(), "Bindless textures are not supported");
+
+    // Handles are unique per texture, only the first call makes them resident
+    const GLuint64 handle = get_texture_handle(texture);
+    if(!is_texture_handle_resident(handle)) {
+        make_texture_handle_resident(handle);
+    }
+    return handle;
+}
+
 void init_graphics() {
     ALWAYS_ASSERT(gladLoadGLLoader((GLADloadproc)(glfwGetProcAddress)), "glad initialization failed");
 
-    std::cout << "OpenGL " << glGetString(GL_VERSION) << " initialized on " << glGetString(GL_VENDOR) << " " << glGetString(GL_RENDERER) << " using GLSL " << glGetString(GL_SHADING_LANGUAGE_VERSION) << std::endl;
+    if(glfwExtensionSupported("GL_ARB_bindless_texture")) {
+        get_texture_handle = reinterpret_cast<decltype(get_texture_handle)>(glfwGetProcAddress("glGetTextureHandleARB"));
+        make_texture_handle_resident = reinterpret_cast<decltype(make_texture_handle_resident)>(glfwGetProcAddress("glMakeTextureHandleResidentARB"));
+        is_texture_handle_resident = reinterpret_cast<decltype(is_texture_handle_resident)>(glfwGetProcAddress("glIsTextureHandleResidentARB"));
+        if(!make_texture_handle_resident || !is_texture_handle_resident) {
+            get_texture_handle = nullptr;
+        }
+    }
+
+    std::cout << "OpenGL " << glGetString(GL_VERSION) << " initialized on " << glGetString(GL_VENDOR) << " " << glGetString(GL_RENDERER) << " using GLSL " << glGetString(GL_SHADING_LANGUAGE_VERSION) << (has_bindless_textures() ? " with bindless textures" : "") << std::endl;
 
     glClearColor(0.5f, 0.7f, 0.8f, 0.0f);
 
@@ -90,6 +122,9 @@ void init_graphics() {
         glClearDepthf(0.0f);
     }
 
+    // Pixel data is always tightly packed, RGB8 rows are not 4 bytes aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
     glGenVertexArrays(1, &global_vao);
     glBindVertexArray(global_vao);
 
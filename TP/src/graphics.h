@@ -47,6 +47,13 @@ enum class BufferUsage {
     Index,
     Uniform,
     Storage,
+    Indirect,
+};
+
+enum class BufferStorage {
+    Static,
+    // Immutable storage, mapped once for writing with coherent persistent mapping
+    PersistentWrite,
 };
 
 enum class AccessType {
@@ -55,6 +62,15 @@ enum class AccessType {
     ReadWrite
 };
 
+// Layout expected by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand {
+    u32 index_count;
+    u32 instance_count;
+    u32 first_index;
+    i32 base_vertex;
+    u32 base_instance;
+};
+
 u32 buffer_usage_to_gl(BufferUsage usage);
 u32 access_type_to_gl(AccessType access);
 
@@ -62,6 +78,11 @@ u32 align_up_to(u32 val, u32 up_to);
 
 void init_graphics();
 
+// GL_ARB_bindless_texture is not part of the core profile glad loads: init_graphics() loads it when the driver exposes it
+bool has_bindless_textures();
+// Handle of the texture with its own sampler state, resident until the texture is deleted
+u64 resident_texture_handle(u32 texture);
+
 }
 
 #endif // GRAPHICS_H
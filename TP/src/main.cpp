@@ -7,12 +7,17 @@
 #include <vector>
 #include <string>
 #include <filesystem>
+#include <random>
 
 #include <graphics.h>
 #include <SceneView.h>
+#include <SceneLoader.h>
 #include <Texture.h>
 #include <Framebuffer.h>
 #include <ImGuiRenderer.h>
+#include <GpuTimer.h>
+#include <LightClusters.h>
+#include <LightVolumes.h>
 #include <Material.h>
 
 #include <imgui/imgui.h>
@@ -22,6 +27,8 @@ using namespace OM3D;
 
 static float delta_time = 0.0f;
 const glm::uvec2 window_size(1600, 900);
+// Bytes of textures and meshes uploaded per frame while a scene is loading
+const size_t scene_upload_budget = 16 * 1024 * 1024;
 
 
 void glfw_check(bool cond) {
@@ -91,6 +98,18 @@ void process_inputs(GLFWwindow* window, Camera& camera) {
     mouse_pos = new_mouse_pos;
 }
 
+int pick_object(GLFWwindow* window, const Scene& scene, const Camera& camera) {
+    glm::dvec2 mouse_pos;
+    glfwGetCursorPos(window, &mouse_pos.x, &mouse_pos.y);
+
+    glm::ivec2 size;
+    glfwGetWindowSize(window, &size.x, &size.y);
+
+    const glm::vec2 ndc(float(mouse_pos.x / size.x) * 2.0f - 1.0f, 1.0f - float(mouse_pos.y / size.y) * 2.0f);
+    const auto hit = scene.pick(Ray{camera.position(), camera.ray_direction(ndc)});
+    return hit.is_ok ? int(hit.value.item) : -1;
+}
+
 
 std::unique_ptr<Scene> create_default_scene() {
     auto scene = std::make_unique<Scene>();
@@ -119,6 +138,30 @@ std::unique_ptr<Scene> create_default_scene() {
     return scene;
 }
 
+std::unique_ptr<Scene> create_light_stress_scene() {
+    auto result = Scene::from_gltf(std::string(data_path) + "forest.glb");
+    ALWAYS_ASSERT(result.is_ok, "Unable to load stress test scene");
+    std::unique_ptr<Scene> scene = std::move(result.value);
+
+    const AABB bounds = scene->bounding_box();
+    const glm::vec3 extent = bounds.extent();
+    const float radius = std::max(extent.x, std::max(extent.y, extent.z)) / 50.0f;
+
+    // Fixed seed, so every run measures the same thing
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<float> unorm(0.0f, 1.0f);
+
+    for(u32 i = 0; i != 10000; ++i) {
+        PointLight light;
+        light.set_position(bounds.min + extent * glm::vec3(unorm(rng), unorm(rng), unorm(rng)));
+        light.set_color(glm::vec3(unorm(rng), unorm(rng), unorm(rng)) * 5.0f);
+        light.set_radius(radius);
+        scene->add_object(std::move(light));
+    }
+
+    return scene;
+}
+
 
 int main(int, char**) {
     DEBUG_ASSERT([] { std::cout << "Debug asserts enabled" << std::endl; return true; }());
@@ -143,7 +186,11 @@ int main(int, char**) {
 
     std::vector<std::string> files;
     for(const auto& entry : std::filesystem::directory_iterator(data_path)) {
-        files.push_back(entry.path().string());
+        // Skip cooked scenes and anything else that is not a scene
+        const std::string path = entry.path().string();
+        if(ends_with(path, ".glb") || ends_with(path, ".gltf")) {
+            files.push_back(path);
+        }
     }
 
     ImGuiRenderer imgui(window);
@@ -151,12 +198,17 @@ int main(int, char**) {
     std::unique_ptr<Scene> scene = create_default_scene();
     SceneView scene_view(scene.get());
 
-    std::shared_ptr<Texture> color = std::make_shared<Texture>(window_size, ImageFormat::RGBA8_UNORM);
-    std::shared_ptr<Texture> normal = std::make_shared<Texture>(window_size, ImageFormat::RGBA8_UNORM);
+    // Albedo (alpha is free for roughness or metallic) and octahedral normals.
+    // Normals are RG16, or RG8 with compact normals, which trades precision for bandwidth.
+    std::shared_ptr<Texture> color = std::make_shared<Texture>(window_size, ImageFormat::RGBA8_sRGB);
+    std::shared_ptr<Texture> normal = std::make_shared<Texture>(window_size, ImageFormat::RG16_UNORM);
+    std::shared_ptr<Texture> compact_normal = std::make_shared<Texture>(window_size, ImageFormat::RG8_UNORM);
     std::shared_ptr<Texture> depth = std::make_shared<Texture>(window_size, ImageFormat::Depth32_FLOAT);
     Framebuffer gbuffer(depth.get(), std::array{color.get(), normal.get()});
+    Framebuffer compact_gbuffer(depth.get(), std::array{color.get(), compact_normal.get()});
+    bool compact_normals = false;
 
-    std::shared_ptr<Texture> lit = std::make_shared<Texture>(window_size, ImageFormat::RGBA16_FLOAT);
+    std::shared_ptr<Texture> lit = std::make_shared<Texture>(window_size, ImageFormat::R11G11B10_FLOAT);
     Framebuffer main_framebuffer(depth.get(), std::array{lit.get()});
 
     std::shared_ptr<Texture> tonemap_color = std::make_shared<Texture>(window_size, ImageFormat::RGBA8_UNORM);
@@ -164,6 +216,10 @@ int main(int, char**) {
 
     auto tonemap_program = Program::from_file("tonemap.comp");
 
+    LightClusters light_clusters(window_size);
+    LightVolumes light_volumes(color, normal, depth);
+    bool use_light_volumes = false;
+
     const auto programs = std::array{
         Program::from_files("lit.frag", "screen.vert"),
         Program::from_files("lit.frag", "screen.vert", {"DEBUG_COLOR"}),
@@ -171,6 +227,7 @@ int main(int, char**) {
         Program::from_files("lit.frag", "screen.vert", {"DEBUG_LIGHT"}),
         Program::from_files("lit.frag", "screen.vert", {"DEBUG_DEPTH"}),
     };
+    const auto sun_only_program = Program::from_files("lit.frag", "screen.vert", {"LIGHT_VOLUMES"});
     static bool use_tonemap = true;
     static bool debug = false;
     static int debug_mode = 1;
@@ -185,6 +242,15 @@ int main(int, char**) {
     gbuffer_material.set_depth_test_mode(DepthTestMode::None);
     gbuffer_material.set_depth_write(false);
 
+    RenderSettings render_settings;
+    render_settings.viewport_height = window_size.y;
+    RenderStats render_stats;
+    GpuTimer gbuffer_timer;
+    GpuTimer lighting_timer;
+    int picked_object = -1;
+    std::unique_ptr<SceneLoader> scene_loader;
+    bool compact_vertices = false;
+
     for(;;) {
         glfwPollEvents();
         if(glfwWindowShouldClose(window) || glfwGetKey(window, GLFW_KEY_ESCAPE)) {
@@ -193,25 +259,58 @@ int main(int, char**) {
 
         update_delta_time();
 
+        if(scene_loader) {
+            scene_loader->update(scene_upload_budget);
+            if(scene_loader->state() == SceneLoader::State::Done) {
+                scene = scene_loader->take_scene();
+                scene_view = SceneView(scene.get());
+                picked_object = -1;
+            }
+            if(scene_loader->state() == SceneLoader::State::Done || scene_loader->state() == SceneLoader::State::Failed) {
+                scene_loader = nullptr;
+            }
+        }
+
         if(const auto& io = ImGui::GetIO(); !io.WantCaptureMouse && !io.WantCaptureKeyboard) {
             process_inputs(window, scene_view.camera());
+
+            if(glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS) {
+                picked_object = pick_object(window, *scene, scene_view.camera());
+            }
         }
 
+        scene->update_frame_data(scene_view.camera(), render_settings);
+        scene->stream_textures(scene_view.camera(), render_settings);
+
         // Render in gbuffer
         {
-            gbuffer.bind();
-            scene_view.render();
+            (compact_normals ? compact_gbuffer : gbuffer).bind();
+            gbuffer_timer.begin();
+            // Albedo is written in linear and stored as sRGB
+            glEnable(GL_FRAMEBUFFER_SRGB);
+            render_stats = scene_view.render(render_settings, depth.get());
+            glDisable(GL_FRAMEBUFFER_SRGB);
+            gbuffer_timer.end();
         }
 
         // Compute lighting gbuffer
         {
-            auto frame_data_buffer = scene->frame_data_buffer(scene_view.camera());
-            frame_data_buffer->bind(BufferUsage::Uniform, 0);
-            auto point_light_buffer = scene->point_light_buffer();
-            point_light_buffer->bind(BufferUsage::Storage, 1);
+            lighting_timer.begin();
+            scene->bind_frame_data();
+            const bool draw_light_volumes = use_light_volumes && !debug;
+            if(!draw_light_volumes) {
+                light_clusters.build(*depth);
+            }
+
+            // Keep the G-buffer depth, light volumes are depth tested against it
+            main_framebuffer.bind(true, false);
             gbuffer_material.bind();
-            main_framebuffer.bind();
             glDrawArrays(GL_TRIANGLES, 0, 3);
+
+            if(draw_light_volumes) {
+                light_volumes.render(scene->submitted_lights(), scene_view.camera().position());
+            }
+            lighting_timer.end();
         }
         
         // Tonemap
@@ -232,16 +331,79 @@ int main(int, char**) {
         // GUI
         imgui.start();
         {
-            for (const auto& path : files) {
-                if(ImGui::Button(path.c_str())) {
-                    auto result = Scene::from_gltf(path);
-                    if(!result.is_ok) {
-                        std::cerr << "Unable to load scene (" << path << ")" << std::endl;
-                    } else {
-                        scene = std::move(result.value);
-                        scene_view = SceneView(scene.get());
+            if(ImGui::Button("Light stress test (10k lights)")) {
+                scene = create_light_stress_scene();
+                scene_view = SceneView(scene.get());
+                picked_object = -1;
+            }
+            if(scene_loader) {
+                const char* stage = scene_loader->state() == SceneLoader::State::Decoding ? "Decoding" : "Uploading";
+                ImGui::Text("%s %s", stage, scene_loader->file_name().c_str());
+                ImGui::ProgressBar(scene_loader->progress());
+            } else {
+                for (const auto& path : files) {
+                    if(ImGui::Button(path.c_str())) {
+                        scene_loader = std::make_unique<SceneLoader>(path, compact_vertices ? VertexFormat::Compact : VertexFormat::Standard);
                     }
                 }
+                ImGui::Checkbox("Compact vertices (next load)", &compact_vertices);
+            }
+            if(render_settings.gpu_culling) {
+                ImGui::Text("Objects: %u drawn, %u culled, %u occluded", render_stats.drawn_objects, render_stats.culled_objects, render_stats.occluded_objects);
+                if(render_settings.meshlet_culling) {
+                    ImGui::Text("Meshlets: %u drawn, %u culled", render_stats.drawn_meshlets, render_stats.culled_meshlets);
+                }
+            } else {
+                ImGui::Text("Objects: %u drawn, %u culled", render_stats.drawn_objects, render_stats.culled_objects);
+            }
+            ImGui::Text("Draw calls: %u", render_stats.draw_calls);
+            ImGui::Text("Bindless textures: %s", has_bindless_textures() ? "on" : "off");
+            static_assert(max_mesh_lods == 4);
+            ImGui::Text("LODs: %u / %u / %u / %u objects, %.1fk triangles", render_stats.lod_objects[0], render_stats.lod_objects[1], render_stats.lod_objects[2], render_stats.lod_objects[3], double(render_stats.drawn_triangles) / 1000.0);
+            ImGui::Text("Culling: %.3f ms", render_stats.culling_time * 1000.0);
+            ImGui::Text("G-buffer GPU time: %.3f ms", gbuffer_timer.elapsed() * 1000.0);
+            ImGui::Text("Lighting GPU time: %.3f ms (%u lights)", lighting_timer.elapsed() * 1000.0, u32(scene->point_light_count()));
+            if(ImGui::Checkbox("Compact normals (RG8)", &compact_normals)) {
+                const auto& normal_texture = compact_normals ? compact_normal : normal;
+                gbuffer_material.set_texture(1u, normal_texture);
+                light_volumes.set_normal_texture(normal_texture);
+            }
+            {
+                // Per pixel, not counting overdraw: the G-buffer pass writes every target once, the lighting pass reads them back
+                const u32 gbuffer_bytes = bytes_per_pixel(color->format()) + bytes_per_pixel((compact_normals ? compact_normal : normal)->format()) + bytes_per_pixel(depth->format());
+                ImGui::Text("Bandwidth: %u B/px G-buffer, %u B/px lit", gbuffer_bytes, bytes_per_pixel(lit->format()));
+            }
+            ImGui::Text("State changes: %u emitted, %u avoided", render_stats.state_changes, render_stats.avoided_state_changes);
+            {
+                const TextureStreamer& streamer = scene->texture_streamer();
+                const TextureStreamer::Stats& stats = streamer.stats();
+                ImGui::Text("Textures: %.1f / %u MB, %u levels uploaded (%.3f ms), %u evicted", double(stats.resident_bytes) / (1024.0 * 1024.0), render_settings.texture_budget_mb, stats.uploaded_levels, stats.upload_time * 1000.0, stats.evicted_levels);
+                ImGui::InputScalar("Texture budget (MB)", ImGuiDataType_U32, &render_settings.texture_budget_mb);
+                ImGui::SliderFloat("Texture upload time (ms)", &render_settings.texture_upload_ms, 0.0f, 16.0f);
+                if(ImGui::TreeNode("Texture memory")) {
+                    const auto infos = streamer.texture_infos();
+                    for(size_t i = 0; i != infos.size(); ++i) {
+                        const TextureStreamer::TextureInfo& info = infos[i];
+                        const glm::uvec2 resident_size = glm::max(glm::uvec2(1), info.size >> info.resident_mip);
+                        ImGui::Text("#%u %ux%u: %ux%u resident (mip %u, wants %u), %.1f KB%s", u32(i), info.size.x, info.size.y, resident_size.x, resident_size.y,
+                                    info.resident_mip, info.wanted_mip, double(info.resident_bytes) / 1024.0, info.streamed ? "" : ", not streamed");
+                    }
+                    ImGui::TreePop();
+                }
+            }
+            ImGui::Checkbox("BVH culling", &render_settings.bvh_culling);
+            ImGui::Checkbox("Multi-draw indirect", &render_settings.multi_draw);
+            ImGui::Checkbox("Depth pre-pass", &render_settings.depth_prepass);
+            ImGui::SliderFloat("LOD pixel error", &render_settings.lod_pixel_error, 0.0f, 16.0f);
+            ImGui::Checkbox("GPU culling", &render_settings.gpu_culling);
+            if(render_settings.gpu_culling) {
+                ImGui::Checkbox("Occlusion culling", &render_settings.occlusion_culling);
+                ImGui::Checkbox("Meshlet culling", &render_settings.meshlet_culling);
+            }
+            if(picked_object >= 0) {
+                ImGui::Text("Picked object: %d", picked_object);
+            } else {
+                ImGui::Text("Right click to pick an object");
             }
             ImGui::Checkbox("Use tonemap", &use_tonemap);
             ImGui::Checkbox("Debug shader", &debug);
@@ -251,7 +413,10 @@ int main(int, char**) {
                 ImGui::RadioButton("Light", &debug_mode, 3);
                 ImGui::RadioButton("Depth", &debug_mode, 4);
             }
-            gbuffer_material.set_program(programs[debug ? debug_mode : 0]);
+            ImGui::Checkbox("Light volumes", &use_light_volumes);
+            ImGui::Text("Lights: %u submitted, %u culled", render_stats.submitted_lights, render_stats.culled_lights);
+            ImGui::InputScalar("Light budget (0 for none)", ImGuiDataType_U32, &render_settings.light_budget);
+            gbuffer_material.set_program(debug ? programs[debug_mode] : use_light_volumes ? sun_only_program : programs[0]);
         }
         imgui.finish();
 